@@ -48,7 +48,8 @@ namespace EvalException
 
   /**
    * BaseException/BadArgument
-   * Thrown if the user does not provide exactly 1 expression.
+   * Thrown if the user does not provide exactly 1 expression (or the
+   * options of the batch mode).
    */
   struct BadArgument : public BaseException
   {
@@ -56,6 +57,16 @@ namespace EvalException
     virtual const char* what() const throw() override;
   };
 
+  /**
+   * BaseException/BadFile
+   * Thrown if the file of expressions given in batch mode cannot be read.
+   */
+  struct BadFile : public BaseException
+  {
+    virtual Code code() const override;
+    virtual const char* what() const throw() override;
+  };
+
   /**
    * BaseException/BadImplementation
    * Thrown if the program logic is broken.
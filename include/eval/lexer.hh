@@ -23,7 +23,14 @@ class Lexer
      * throws any exception, then the Lexer instance is actually constructed
      * (with possibly bad attribute values) but never used.
      */
-    Lexer(std::string expression);
+    Lexer(const std::string& expression);
+
+    /**
+     * Same as the constructor, but read a new expression with the same
+     * lexer (without checking the operator traits again), reusing the
+     * storage of the previous one.
+     */
+    void read(const std::string& expression);
 
     /**
      * Read (consume) the next token, and return it as an operator.
@@ -32,6 +39,12 @@ class Lexer
      */
     Operator next_token() const;
 
+    /**
+     * Go back to the first token, to split the expression into tokens
+     * again. This method can be made const for the same reason as above.
+     */
+    void rewind() const;
+
   private:
     /// Expression to be split into tokens.
     std::string expression_;
@@ -75,7 +88,7 @@ class Lexer
 
     /**
      * Remove all whitespaces (e.g. ' ', '\n', '\r', '\t') from expression_
-     * before next_token() splits it into tokens.
+     * before next_token() splits it into tokens. This is made in place.
      */
     void remove_whitespaces();
 };
@@ -4,9 +4,11 @@
 #include <vector>
 
 class Lexer; // forward declaration
+class Program; // forward declaration
 class Operator
 {
   friend Lexer; // Operators are constructed by Lexer instances only.
+  friend Program; // Programs compile operators w.r.t. their types.
 
   public:
   /**
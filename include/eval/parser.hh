@@ -2,10 +2,13 @@
 
 #include <stack>
 #include <string>
+#include <vector>
 
 #include "lexer.hh"
 #include "operator.hh"
+#include "program.hh"
 #include "../tree/bin_tree.hh"
+#include "../tree/tree_builder.hh"
 
 /* Type alias for ASTs. */
 using AST = BinaryTree<Operator>;
@@ -16,42 +19,96 @@ class Parser
 {
   public:
     /// Constructor. The lexer used by the parser is set automatically.
-    Parser(std::string expression);
+    Parser(const std::string& expression = "");
 
     /**
-     * Evaluate the expression, using an AST which is a BinaryTree (see the
-     * documentation of this class).
-     * An expression yielding a valid but empty AST is evaluated as 0.
-     * Throw an EvalException::BadOperatorImplementation exception if, for
-     * some reason, the expression cannot be evaluated. Actually, this must
-     * not happen here, because if the expression in invalid, then while
-     * building the AST, pop_operator_and_add_node() (see below) must already
-     * have thrown an exception.
+     * Build the AST corresponding to the expression, using Dijkstra's
+     * Shunting-yard Algorithm (see shunting_yard() below), e.g. to print it.
+     * The stack of ASTs is handled by a TreeBuilder, so that the ASTs are
+     * never copied, and the whole AST is built in linear time.
+     * Here and in the other const methods below, the parser is not modified
+     * (the expression is read by a copy of the lexer), so a const parser
+     * can be shared between threads.
+     * An empty (but valid) expression yields an empty AST.
+     * Throw an EvalException::ParserError exception if the expression is
+     * syntactically invalid.
+     */
+    AST ast() const;
+
+    /**
+     * Compile the expression into a Program (see this class), using the
+     * Shunting-yard Algorithm too: its output, which is the RPN, is
+     * directly appended to the program, and the numbers are converted once
+     * and for all. The program can then be run many times, without the
+     * lexer, the parser or any AST.
+     * The second version fills a given program, reusing its storage.
+     * Throw an EvalException::ParserError exception if the expression is
+     * syntactically invalid, and an std::out_of_range exception if a number
+     * is not a long integer.
+     */
+    Program compile() const;
+    void compile(Program& program) const;
+
+    /**
+     * Evaluate the expression: compile it, and run the program.
+     * An empty (but valid) expression is evaluated as 0.
+     * Throw the same exceptions as compile() above and Program::run().
      */
     long eval() const;
 
+    /**
+     * Same as above, but evaluate a new expression with the same parser,
+     * e.g. to evaluate many expressions in a row: the lexer, the stack of
+     * operators and the program of the parser keep their storage from one
+     * expression to the next one, so they stop allocating.
+     * Throw the same exceptions as the constructor and eval() above; the
+     * parser can still be used after any of them.
+     */
+    long eval(const std::string& expression);
+
   private:
+    /// Stack of operators of the Shunting-yard Algorithm.
+    using OperatorStack = std::stack<Operator, std::vector<Operator>>;
+
     /**
      * Lexer needed by the parser.
-     * It can be made const, because we only use the next_token() method from
-     * it, which is also made const (see the Lexer class for details).
+     * We only use the next_token() and rewind() methods from it, which are
+     * const (see the Lexer class for details), but it reads every new
+     * expression given to eval(expression).
      */
-    const Lexer lexer_;
+    Lexer lexer_;
+
+    /**
+     * Scratch storage reused by eval(expression): the stack of operators,
+     * and the compiled program. They are cleared before being used, as an
+     * evaluation may have failed midway. The const methods use their own.
+     */
+    OperatorStack operators_;
+    Program program_;
 
     /**
-     * Build the AST corresponding to the expression, using
      * Dijkstra's Shunting-yard Algorithm. For more details concerning this
      * algorithm, please refer to the class documentation.
+     * The tokens are read from a lexer (rewound first), and O is the stack
+     * of operators (emptied first).
+     * The operands and the operators are given to a builder in RPN order,
+     * as to a TreeBuilder: push_leaf(number) pushes a number, and
+     * push_node(o, r) an operator o with arity r, whose operands are the
+     * last r items pushed; nb_subtrees() is the number of pending items.
+     * The builder is either a TreeBuilder<Operator> (see ast()), or a
+     * Program (see compile()); it is cleared first.
      * If any step from this algorithm fails, meaning that the expression
      * is syntactically invalid, an EvalException::ParserError is thrown.
      * pop_operator_and_add_node() is the part of the algorithm that is run
-     * when an operator is popped from the stack, and a new AST is built from
-     * this operator and the children ASTs. If this method meets a
+     * when an operator is popped from the stack, and given to the builder
+     * along with its operands. If this method meets a
      * non-unary and non-binary operator (this must not happen, because the
      * Lexer instance has already checked this), an
      * EvalException::BadOperatorImplementation exception is thrown.
      */
-    AST ast() const;
-    void pop_operator_and_add_node(\
-        std::stack<Operator>& O, std::stack<AST>& A) const;
+    template <typename Builder>
+    void shunting_yard(const Lexer& lexer, OperatorStack& O, Builder& A) \
+      const;
+    template <typename Builder>
+    void pop_operator_and_add_node(OperatorStack& O, Builder& A) const;
 };
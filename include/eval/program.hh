@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+#include "operator.hh"
+
+class Parser; // forward declaration
+class Program
+{
+  friend Parser; // Programs are compiled by Parser instances only.
+
+  public:
+  /**
+   * Run the program, i.e. evaluate the compiled expression, and return its
+   * value. An empty program (compiled from an empty expression) gives 0.
+   * Throw an EvalException::DivisionByZero exception if one attempts to
+   * divide by 0 (see Operator::eval()).
+   * The program is not modified, so it can be run again and again: the
+   * expression is only lexed and parsed once, by Parser::compile().
+   */
+  long run() const;
+
+  /// Tell if the program is empty.
+  bool empty() const;
+
+  private:
+  /**
+   * Instruction codes. Every instruction pops its operands from the stack
+   * of values, and pushes its result; PUSH pushes the next literal.
+   * The unary plus is compiled to no instruction at all.
+   */
+  enum Opcode : unsigned char
+  {
+    PUSH,
+    NEGATE,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    REMAINDER,
+    POWER
+  };
+
+  /// Size of the stack of values allocated on the call stack by run().
+  static const size_t fixed_stack_size = 64;
+
+  /**
+   * Instructions (in RPN order), and literals (the numbers of the
+   * expression, already converted to long integers, in the same order).
+   */
+  std::vector<Opcode> code_;
+  std::vector<long> literals_;
+
+  /**
+   * Number of values on the stack after the last instruction, and maximal
+   * number of values on the stack: run() needs a stack of this size.
+   */
+  size_t nb_values_ = 0;
+  size_t max_nb_values_ = 0;
+
+  /**
+   * Compilation, made by Parser::compile() with the same interface as a
+   * TreeBuilder: the tokens are given in RPN order, and every number
+   * (resp. operator) is appended to the program as a PUSH instruction and
+   * its value (resp. as its instruction), so the RPN never needs to be
+   * stored in between.
+   * push_leaf() throws an std::out_of_range exception if the number is not
+   * a long integer, and push_node() an EvalException::BadOperatorArguments
+   * exception if the operator is not an arithmetic one, or if there are
+   * less than 'arity' values on the stack.
+   * nb_subtrees() is the number of values on the stack, and clear() empties
+   * the program, keeping its storage.
+   */
+  void push_leaf(const Operator& number);
+  void push_node(const Operator& o, size_t arity);
+  size_t nb_subtrees() const;
+  void clear();
+};
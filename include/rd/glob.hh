@@ -0,0 +1,82 @@
+#pragma once
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+/* Glob interface. */
+
+/**
+ * Set of shell wildcard patterns, as in fnmatch(3) (without flags), matched
+ * against directory names (see the --prune and --exclude options of rd):
+ * '*' matches any string, '?' any byte, "[...]" any byte of a set (with
+ * ranges such as "a-z", and negated by a leading '!' or '^'), and '\' makes
+ * the next character literal, also in a set (e.g., "[\]]" matches "]"). As
+ * with the -I option of tree, a pattern may hold several alternatives
+ * separated by '|' (outside of the sets).
+ * The patterns are compiled once into sequences of tokens, so matching a
+ * name neither parses them nor allocates memory.
+ */
+class Glob
+{
+  public:
+    /// Constructor. A name matches if it matches one of the patterns.
+    Glob(const std::vector<std::string>& patterns = {});
+
+    /// Whether there is no pattern (so that no name matches).
+    bool empty() const;
+
+    /// Whether a null-terminated name matches one of the patterns.
+    bool match(const char* name) const;
+
+  private:
+    /**
+     * Token of a compiled pattern: a literal string, any byte, any string
+     * (star), or a set of bytes.
+     */
+    struct Token
+    {
+      enum Kind { LITERAL, ANY, STAR, SET } kind;
+      std::string literal;
+      std::bitset<256> set;
+    };
+
+    /**
+     * Compiled alternative: its tokens, and its tail, i.e., the tokens
+     * after the last star (all of them if there is none), which match the
+     * end of a name, with its length in bytes.
+     */
+    struct Alternative
+    {
+      std::vector<Token> tokens;
+      size_t tail;
+      size_t tail_size;
+    };
+
+    /// Compiled alternatives of all the patterns.
+    std::vector<Alternative> alternatives_;
+
+    /// Compile an alternative (without '|').
+    static Alternative compile(const std::string& pattern);
+
+    /**
+     * Position of the closing bracket of the set opened by the '[' at pos in
+     * a pattern, or std::string::npos if there is none (the '[' is then
+     * literal). A ']' right after the opening bracket (or its negation) is
+     * literal, and so is an escaped one.
+     */
+    static size_t set_end(const std::string& pattern, size_t pos);
+
+    /**
+     * Whether a name matches a compiled alternative. The tail is matched
+     * first, at the end of the name, so a pattern such as "*.d" does not
+     * backtrack.
+     */
+    static bool match(const Alternative& alternative, const char* name);
+
+    /**
+     * Match a token other than a star at s, before end, and move s after
+     * the matched bytes. Return false if it does not match.
+     */
+    static bool match(const Token& token, const char*& s, const char* end);
+};
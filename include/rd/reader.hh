@@ -1,9 +1,16 @@
 #pragma once
 
+#include <cstdint> // uint64_t
+#include <functional> // std::function
 #include <memory> // std::shared_ptr
+#include <ostream>
 #include <string>
 #include <vector>
 
+#include "../tree/tree.hh"
+#include "glob.hh"
+#include "record_writer.hh"
+
 /* Type aliases */
 
 /// Shorter names for accepted path types.
@@ -22,6 +29,112 @@ using Ptr = std::shared_ptr<T>;
 template <typename T>
 using Table = std::vector<std::pair<Ptr<T>, std::vector<Ptr<T>>>>;
 
+/* Options */
+
+/// Orders of the subdirectories of every directory (see the --sort option).
+enum class SortOrder
+{
+  none, // the order of the entries in the directory
+  name, // byte-wise order of the names (independent of the locale)
+  mtime, // oldest first
+  size // largest first (with du, w.r.t. the disk usage)
+};
+
+/// Options of the directory search (see the rd usage documentation).
+struct ReaderOptions
+{
+  /**
+   * Number of threads reading directories. With 1 thread (default), the
+   * search is serial; otherwise, it is made by a work-stealing thread pool.
+   * The result does not depend on the number of threads.
+   */
+  size_t nb_threads = 1;
+
+  /**
+   * Print every line of the tree as soon as it is known, instead of
+   * building the whole tree first. The output is the same, but the memory
+   * used no longer grows with the number of directories. The search is
+   * then serial (nb_threads is ignored).
+   */
+  bool stream = false;
+
+  /**
+   * Path of the cache file of the search (none if empty). The directories
+   * which have not changed since the previous search with the same cache
+   * (see ScanCache) are not read again, and the cache is then updated.
+   * The search is then serial (nb_threads is ignored). The cache is only
+   * supported on Linux, and ignored elsewhere.
+   */
+  String cache_file;
+
+  /**
+   * Maximal depth of the listed directories (the top directory having
+   * depth 0), or 0 for no limit. The directories at this depth are listed,
+   * but not read.
+   */
+  size_t max_depth = 0;
+
+  /**
+   * Patterns of the names of the directories which are listed but not read
+   * (prune), and of those which are neither listed nor read (exclude); see
+   * Glob. The top directory is always read.
+   * With max_depth, prune or exclude, the cache is ignored.
+   */
+  std::vector<String> prune;
+  std::vector<String> exclude;
+
+  /**
+   * Print the disk usage of every directory, like du: the bytes allocated
+   * to its subtree, and its number of inodes (every entry is counted, but
+   * the hidden directories are not searched, as they are not listed).
+   * The files of every directory are stated by a batch of statx() calls
+   * relative to it, on nb_threads threads. The search is then serial, but
+   * for the statx() calls (stream and cache_file are ignored). The excluded
+   * directories are not counted, whereas those which are not expanded
+   * (see max_depth and prune) are still searched, but their subdirectories
+   * are not listed. The disk usage is only supported on Linux.
+   */
+  bool du = false;
+
+  /**
+   * Output format: the tree drawing (default), or one record per directory
+   * (see RecordWriter). The records are written by the walk as soon as the
+   * directories are reached (as with stream), or from the tree if several
+   * threads are used. With du, they have the disk usage.
+   */
+  OutputFormat format = OutputFormat::text;
+
+  /**
+   * Order of the subdirectories of every directory (by default, that of
+   * the filesystem, which may vary). Ties are broken by name. The
+   * subdirectories are sorted as soon as they are read, so the order
+   * holds with the parallel search and the streaming.
+   */
+  SortOrder sort = SortOrder::none;
+
+  /**
+   * List the files too (every entry which is not a directory: regular
+   * files, symbolic links, devices...), as leaves of the tree, and also the
+   * hidden entries (starting with "."), like the -a option of tree. The
+   * type of every entry is given by the directory itself; it is only
+   * stated when its filesystem does not tell it. Excluded files are not
+   * listed (see exclude). The search is then serial, without cache (stream
+   * is supported, nb_threads and cache_file are ignored); files is ignored
+   * with du.
+   */
+  bool files = false;
+  bool hidden = false;
+
+  /**
+   * Path of a file where the tree is saved after the search, as a snapshot
+   * which can be printed again without searching (see MappedTree<T>), or
+   * none if empty. It is only saved with the tree drawing (it is ignored
+   * with stream, du, format and files). Throw a std::system_error exception
+   * if writing it fails.
+   */
+  String snapshot_file;
+};
+
 /* Class interface */
 
 class DirectoryReader
@@ -29,32 +142,235 @@ class DirectoryReader
   public:
     /**
      * Constructors.
-     * Their unique argument is the top directory path, given either as a
-     * std::string, or as a "à la C" char*.
+     * Their first argument is the top directory path, given either as a
+     * std::string, or as a "à la C" char*, and their second argument the
+     * options of the search.
      */
-    DirectoryReader(const Path& path = ".");
-    DirectoryReader(const String& string = ".");
+    DirectoryReader(const Path& path = ".", \
+        const ReaderOptions& options = {});
+    DirectoryReader(const String& string = ".", \
+        const ReaderOptions& options = {});
 
     /// Read the directory tree, and return the result as a string.
     std::string read_directory() const;
 
+    /**
+     * Same as above, but stream the result to an output stream as it is
+     * generated, instead of building the whole string in memory.
+     */
+    void read_directory(std::ostream& os) const;
+
+    /**
+     * Read the directory tree, and return the tree of the directory
+     * basenames (the root being the top directory path), as printed by
+     * read_directory(). It is either built by walk(), or from the table if
+     * several threads are used.
+     * Throw a std::error_condition exception if opening the top directory
+     * fails.
+     */
+    Tree<String, InlineValues> tree() const;
+
+    /**
+     * Same as above, but the search is serial, and visit(path) is called
+     * for every directory before it is read, where path is its path
+     * relative to the top directory (which has the empty path).
+     */
+    Tree<String, InlineValues> tree( \
+        const std::function<void(const String&)>& visit) const;
+
+    /**
+     * Number of directories skipped by the last search because of the
+     * options max_depth, prune and exclude: those which are excluded, and
+     * those which are listed but not read.
+     */
+    size_t nb_skipped() const;
+
+    /// Number of files listed by the last search (see ReaderOptions::files).
+    size_t nb_files() const;
+
+    /**
+     * Number of directories which could not be read by the last search for
+     * another reason than permissions or their removal meanwhile (e.g. an
+     * I/O error); each of them is reported on stderr, and listed without
+     * its subdirectories. The parallel search reports them after the
+     * search, in the same order as the serial one.
+     */
+    size_t nb_errors() const;
+
   private:
+    /**
+     * Type of an entry, as a DT_* constant of <dirent.h> (e.g. DT_DIR, or
+     * DT_UNKNOWN if it could not be stated), and its inode number (0 if
+     * unknown, e.g. without files).
+     */
+    struct EntryInfo
+    {
+      unsigned char type;
+      uint64_t ino;
+    };
+
+    /**
+     * Callback of walk() for the other entries of a directory (see below):
+     * its file descriptor, and the null-terminated names of its entries.
+     */
+    using EntriesVisitor = std::function<void(int, String&)>;
+
     /// Top directory path.
     const Path path_;
 
+    /// Options of the search.
+    const ReaderOptions options_;
+
+    /// Compiled patterns of the directories to prune and to exclude.
+    const Glob prune_;
+    const Glob exclude_;
+
+    /**
+     * Numbers of directories skipped, of files listed and of directories
+     * which could not be read by the last search.
+     */
+    mutable size_t nb_skipped_;
+    mutable size_t nb_files_;
+    mutable size_t nb_errors_;
+
     /*
      * Return, as a vector of shared pointers to strings, all directories
      * lying directly below a given directory.
      * Hidden subdirectories (i.e., starting with ".") are discarded.
      * In case of failure (I/O error), do not throw any exception, but
-     * return an empty vector instead.
+     * return an empty vector instead; if 'error' is given, it is set to the
+     * errno of the failure (0 if none).
+     */
+    static std::vector<Ptr<String>> subdirectories(const String& current_dir, \
+        int* error = nullptr);
+
+    /**
+     * Same as above, but with the files too if 'files' is set, and the
+     * hidden entries if 'hidden' is set; the type of every entry is stored
+     * in 'infos'. The entries of unknown type are stated with lstat().
+     */
+    static std::vector<Ptr<String>> list_entries(const String& current_dir, \
+        bool files, bool hidden, std::vector<EntryInfo>& infos, \
+        int* error = nullptr);
+
+    /**
+     * Report on stderr that a directory, given by its path, cannot be read
+     * because of an error (an errno value), and count it (see nb_errors()).
+     */
+    void report(const String& path, int error) const;
+
+    /**
+     * Sort the subdirectories of a directory, given by their paths, w.r.t.
+     * ReaderOptions::sort, and their infos along with them if given.
+     */
+    void sort_subdirectories(std::vector<Ptr<String>>& subdirs, \
+        std::vector<EntryInfo>* infos = nullptr) const;
+
+    /**
+     * Whether a directory, given by its basename and depth, is read (i.e.,
+     * is not pruned, and is above the maximal depth).
+     */
+    bool expands(const char* name, size_t depth) const;
+
+    /// Whether any of the options max_depth, prune and exclude is set.
+    bool filters() const;
+
+    /**
+     * Whether the search is made by parallel_table() (with several threads,
+     * and without cache, files and hidden entries).
+     */
+    bool parallel() const;
+
+#ifdef __linux__
+    /**
+     * Print the tree with the disk usage of every directory (see
+     * ReaderOptions::du). The usage of the entries of every directory is
+     * computed during walk() (by the thread pool if several threads are
+     * used); it is then summed bottom-up over the tree of directory ids
+     * with Tree<T>::reduce_subtrees(), and printed by the TreePrintCompanion
+     * along with the names.
+     * Throw a std::error_condition exception if opening the top directory
+     * fails.
      */
-    static std::vector<Ptr<String>> subdirectories(const String& current_dir);
+    void disk_usage(std::ostream& os) const;
+#endif
 
     /**
      * Store the directory search into a table, and return it.
      * Throw a std::error_condition exception if opening the top directory
      * fails.
+     * If several threads are used, the directories are read by
+     * parallel_table() instead.
      */
     Table<String> table() const;
+
+    /**
+     * Parallel version of the search: every directory is read by a task of
+     * a work-stealing thread pool, which submits a task for each of its
+     * subdirectories. Workers run their own latest tasks first (i.e., they
+     * read their subtrees depth-first), and idle workers steal the oldest
+     * pending directories of the others (i.e., the largest subtrees). The
+     * results are stored in a tree of entries mirroring the directory tree,
+     * which is finally flattened into a table w.r.t. pre-order search: the
+     * table is the same as in the serial search.
+     */
+    Table<String> parallel_table() const;
+
+    /**
+     * Write the directories as records (see ReaderOptions::format): while
+     * walking, or from the tree built by the parallel search.
+     */
+    void records(std::ostream& os) const;
+
+    /**
+     * Print the tree while walking it (see ReaderOptions::stream): every
+     * line is written as soon as the directory is reached, as its parent has
+     * been read completely (so we know whether it is its last subdirectory).
+     */
+    void stream(std::ostream& os) const;
+
+    /**
+     * Serial depth-first search of the directory tree, without any table.
+     * For every directory, enter(name, depth, last, info) is called in
+     * pre-order, and leave(name, nb_subdirs) in post-order, where name is
+     * the basename of the directory ('path_' for the root), as a
+     * null-terminated string, last tells whether it is the last subdirectory
+     * of its parent, and info is its EntryInfo. With files or hidden entries
+     * (see ReaderOptions::files), they are also entered (and left right
+     * after, with no subdirs), in the order of their directory.
+     * Only the subdirectories of the directories on the current path are
+     * stored, so the memory used is proportional to depth x fan-out.
+     * Throw a std::error_condition exception if opening the top directory
+     * fails; the directories which cannot be read have no subdirectories
+     * (see nb_errors()).
+     *
+     * On Linux, every directory is opened relatively to its parent with
+     * openat(), and its entries are read in bulk with getdents64() into a
+     * buffer reused for all directories (only the file descriptors of the
+     * lowest directories on the current path are kept open: the upper ones
+     * are closed, and opened again from their subdirectory as "..", when
+     * needed); the names of the pending subdirectories are kept in a string
+     * arena, and sorted there (if needed) by a radix sort. The entries of
+     * unknown type are stated by a batch of fstatat() calls relative to their
+     * directory, once it is read.
+     * Elsewhere, the directories are read by list_entries().
+     * With a cache (see ReaderOptions::cache_file), it is updated after the
+     * search; throw a std::system_error exception if writing it fails.
+     *
+     * The excluded directories are skipped, and those which are not
+     * expanded (see expands()) are left right after being entered, without
+     * being read.
+     *
+     * If 'entries' is set (on Linux only), entries(fd, names) is called
+     * for every directory which is read, right after enter(), with its
+     * file descriptor and the names of all its entries but its visible
+     * subdirectories, "." and ".." (files are then never entered); it may
+     * take them (e.g., with std::swap), and must duplicate the file
+     * descriptor to use it after returning. The cache is then not used, and
+     * every directory which is not excluded is read: the callbacks must
+     * check expands() themselves.
+     */
+    template <typename Enter, typename Leave>
+    void walk(Enter enter, Leave leave, \
+        const EntriesVisitor& entries = nullptr) const;
 };
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint> // uint32_t, uint64_t
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Output formats */
+
+/// Output formats of rd (see the --format option).
+enum class OutputFormat
+{
+  text, // the tree drawing
+  jsonl, // JSON lines (also known as ndjson)
+  bin // binary records, to be memory-mapped
+};
+
+/* RecordWriter interface. */
+
+/**
+ * Writer of a directory tree as a stream of records, one per directory,
+ * w.r.t. pre-order search: its id (its rank in this order), the id of its
+ * parent, its depth (the root having depth 0), its name, and optionally its
+ * disk usage (bytes and inodes, see the --du option of rd), or its type and
+ * inode number (when files are listed too, see the --files option). The
+ * root name is the top directory path.
+ *
+ * JSON lines: one object per line, e.g.
+ * {"id":1,"parent":0,"depth":1,"name":"bin","bytes":4096,"inodes":1}
+ * {"id":2,"parent":1,"depth":2,"name":"ls","type":"file","ino":1234}
+ * where the parent of the root is null, and the type is one of "dir",
+ * "file", "link", "fifo", "socket", "char", "block" and "unknown". JSON
+ * strings are Unicode, so the bytes of a name which are not valid UTF-8
+ * are replaced by U+FFFD.
+ *
+ * Binary records (native byte order, every part being 8-byte aligned):
+ * - a header: the magic string "rdrecs", a version number, and flags (1 if
+ *   the records have a disk usage, 2 if they have a type);
+ * - the records, each one made of the id of its parent (2^64 - 1 for the
+ *   root), its depth and the size of its name (4 bytes each), then, with
+ *   the disk usage, its bytes and inodes, with the type, its inode number
+ *   (8 bytes) and its type (a DT_* constant of <dirent.h>, 4 bytes, then
+ *   4 bytes of padding), and finally its null-terminated name (the exact
+ *   bytes), padded with zeros;
+ * - the index: the offset of the record of every id in the file;
+ * - a trailer: the number of records, the offset of the index, and the
+ *   magic string again.
+ * The records are written as soon as they are given, and the index at the
+ * end, so the output can be streamed. A consumer maps the file, reads the
+ * trailer at its end, and then reaches the record of any id in constant
+ * time, without parsing anything.
+ */
+class RecordWriter
+{
+  public:
+    /// Parent id of the root in the binary records.
+    static const uint64_t no_parent = static_cast<uint64_t>(-1);
+
+    /**
+     * Constructor. Write the records to an output stream in the given
+     * format (which must not be OutputFormat::text), with or without disk
+     * usage, and with or without type.
+     */
+    RecordWriter(std::ostream& os, OutputFormat format, bool usage = false, \
+        bool typed = false);
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    /**
+     * Write the record of the next entry, given by the id of its parent
+     * (ignored for the root, i.e. at depth 0), its depth, its name, its
+     * disk usage (ignored without usage), and its type and inode number
+     * (ignored without type). The output is buffered.
+     */
+    void write(uint64_t parent, size_t depth, const char* name, \
+        uint64_t bytes = 0, uint64_t inodes = 0, unsigned type = 0, \
+        uint64_t ino = 0);
+
+    /// Write the end of the output (the index of the binary records).
+    void finish();
+
+  private:
+    /**
+     * Output stream, format, and whether the records have disk usage and
+     * type.
+     */
+    std::ostream& os_;
+    const OutputFormat format_;
+    const bool usage_;
+    const bool typed_;
+
+    /// Output buffer, flushed whenever it is larger than 64 KiB.
+    std::string buffer_;
+
+    /**
+     * Number of records, and (for binary records) number of bytes written
+     * so far and offset of every record.
+     */
+    uint64_t nb_records_;
+    uint64_t offset_;
+    std::vector<uint64_t> index_;
+
+    /// Append a number, or a name as a JSON string, to the buffer.
+    void append_number(uint64_t n);
+    void append_string(const char* s);
+
+    /// Append raw bytes to the buffer, padded with zeros to 8 bytes.
+    void append_padded(const void* data, size_t size);
+
+    /// Write the buffer to the output stream.
+    void flush();
+};
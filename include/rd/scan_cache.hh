@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint> // int64_t, uint64_t
+#include <string>
+#include <vector>
+
+#include <sys/stat.h> // struct stat
+
+/* ScanCache interface. */
+
+/**
+ * Snapshot of a directory search, stored on disk between two runs of rd
+ * (see the --cache option). For every directory, in pre-order, it keeps its
+ * name, its number of (visible) subdirectories, and a stamp telling whether
+ * it has changed since: its modification time, inode and device. Adding,
+ * removing or renaming an entry of a directory updates its modification
+ * time, so a directory with the same stamp has the same subdirectories, and
+ * they need not be read again.
+ * A snapshot is either loaded from a file (for lookups), or recorded during
+ * a search (and then saved).
+ *
+ * File format (native byte order): the magic string "rdcache", a version
+ * number, the time of the search, the numbers of directories and of bytes
+ * of names, the root path, then the records of the directories, and finally
+ * their null-terminated names.
+ */
+class ScanCache
+{
+  public:
+    /// Index of no directory.
+    static const size_t npos = static_cast<size_t>(-1);
+
+    /// State of a directory, which changes with its list of entries.
+    struct Stamp
+    {
+      int64_t sec = 0;
+      int64_t nsec = 0;
+      uint64_t ino = 0;
+      uint64_t dev = 0;
+    };
+
+    /// Stamp of a directory, from its status.
+    static Stamp stamp(const struct stat& st);
+
+    /**
+     * Constructor. Make an empty snapshot of a search rooted at the given
+     * path, started at the given time (in seconds since the Epoch).
+     */
+    ScanCache(const std::string& root = "", int64_t scan_time = 0);
+
+    /**
+     * Load the snapshot saved in a file for the same root path. If the file
+     * cannot be read, is not a valid snapshot, or is for another root, the
+     * snapshot is empty, and false is returned.
+     */
+    bool load(const std::string& file);
+
+    /**
+     * Save the snapshot to a file; it is first written to a temporary file,
+     * which is then renamed, so an interrupted run never leaves a truncated
+     * snapshot. Throw a std::system_error exception upon failure.
+     */
+    void save(const std::string& file) const;
+
+    /**
+     * Record a directory, with its stamp and number of subdirectories.
+     * Directories must be recorded w.r.t. pre-order search.
+     */
+    void push(const char* name, const Stamp& stamp, size_t nb_subdirs);
+
+    /// Number of directories in the snapshot.
+    size_t size() const;
+
+    /// Name and number of subdirectories of a directory.
+    const char* name(size_t dir) const;
+    size_t nb_subdirs(size_t dir) const;
+
+    /**
+     * Tell whether a directory is unchanged, i.e., whether it has the given
+     * stamp, and was not modified during the search which recorded it (in
+     * which case it may have changed since within the resolution of the
+     * modification times).
+     */
+    bool fresh(size_t dir, const Stamp& stamp) const;
+
+    /**
+     * Indices of the subdirectories of a directory, in the order of the
+     * search. Only valid for a loaded snapshot.
+     */
+    std::vector<size_t> subdirs(size_t dir) const;
+
+    /**
+     * Index of the subdirectory with the given name of a directory, or npos
+     * if there is none. Only valid for a loaded snapshot. The subdirectories
+     * of the last looked up directory are kept sorted by name, so looking
+     * up all the entries of a directory takes O(k log k) time for k
+     * subdirectories.
+     */
+    size_t find(size_t dir, const char* name) const;
+
+  private:
+    /// Record of a directory in the file.
+    struct Record
+    {
+      Stamp stamp;
+      uint64_t name; // offset in names_
+      uint64_t nb_subdirs;
+    };
+
+    /// Root path and time of the search.
+    std::string root_;
+    int64_t scan_time_;
+
+    /// Records of the directories w.r.t. pre-order search, and their names.
+    std::vector<Record> records_;
+    std::string names_;
+
+    /// Sizes of the subtrees rooted at the directories (computed by load()).
+    std::vector<size_t> subtree_sizes_;
+
+    /// Last directory looked up by find(), and its sorted subdirectories.
+    mutable size_t find_dir_;
+    mutable std::vector<size_t> find_subdirs_;
+};
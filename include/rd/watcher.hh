@@ -0,0 +1,133 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "reader.hh"
+
+struct inotify_event;
+
+/* DirectoryWatcher interface. */
+
+/**
+ * Live directory tree (see the --watch option of rd): after an initial
+ * search, the tree of the directories is kept up to date by applying the
+ * inotify events of all directories, instead of searching them again.
+ * A created (or moved in) directory is searched, and its tree is inserted
+ * as the last child of its parent; a deleted (or moved out) directory has
+ * its subtree removed (see Tree<T>::insert_subtree() and remove_subtree()).
+ * Events are applied in batches, and only the subtrees of the directories
+ * which have changed are printed again.
+ * Only available on Linux.
+ */
+class DirectoryWatcher
+{
+  public:
+    /**
+     * Constructor. Its first argument is the top directory path, and its
+     * second argument the options of the searches (see DirectoryReader).
+     */
+    DirectoryWatcher(const String& path = ".", \
+        const ReaderOptions& options = {});
+
+    /// Destructor. Close the inotify instance.
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    /**
+     * Print the whole tree, and then watch it, until the top directory is
+     * deleted or moved. After every batch of events, print the subtrees of
+     * the changed directories, along with the number of directories, and
+     * the time taken to apply the events to the tree.
+     * Every newline read from the input file descriptor (if it is
+     * non-negative) prints the whole tree again. Nothing is run while no
+     * event is pending, so watching an idle tree uses no CPU time.
+     * Throw a std::error_condition exception if opening the top directory
+     * fails, or a std::system_error exception if inotify fails.
+     */
+    void run(std::ostream& os, int input = -1);
+
+  private:
+    /// Top directory path, and options of the searches.
+    const String path_;
+    const ReaderOptions options_;
+
+    /// Compiled patterns of the directories to prune and to exclude.
+    const Glob prune_;
+    const Glob exclude_;
+
+    /// Tree of the directory basenames (the root being 'path_').
+    Tree<String, InlineValues> tree_;
+
+    /// File descriptor of the inotify instance.
+    int fd_;
+
+    /**
+     * Watched directories: the path of each watch descriptor relative to
+     * the top directory (the top directory having the empty path), and
+     * conversely. The latter is sorted, so that the watches of a subtree
+     * are a range.
+     */
+    std::unordered_map<int, String> paths_;
+    std::map<String, int> watches_;
+
+    /// Whether the limit of inotify watches has been reached.
+    bool exhausted_;
+
+    /**
+     * Ids of the directories removed by the current batch of events, whose
+     * subtrees are removed at once by flush() (e.g., "rm -rf" removes every
+     * directory of a subtree separately).
+     */
+    Ids removed_;
+
+    /// Remove the subtrees of the removed directories from the tree.
+    void flush();
+
+    /// Full path of a directory, given by its relative path.
+    String full_path(const String& path) const;
+
+    /**
+     * Id of a directory in the tree, given by its relative path, or
+     * String::npos if there is none. The second version looks for a
+     * subdirectory of a directory given by its id.
+     */
+    size_t find(const String& path) const;
+    size_t find(size_t id, const String& name) const;
+
+    /**
+     * Apply an event to the tree, and append the relative path of the
+     * changed directory (if any) to 'changed'. Return false if the top
+     * directory is gone. The removed subtrees are only marked; the tree is
+     * up to date after flush().
+     */
+    bool apply(const inotify_event& event, std::vector<String>& changed);
+
+    /// Print the subtree rooted at a directory, given by its relative path.
+    void print(std::ostream& os, const String& path) const;
+
+    /**
+     * Search the directory at a relative path, and return its tree. Every
+     * directory is watched before being read; a directory which is not
+     * expanded (see ReaderOptions::max_depth and prune) is neither read nor
+     * watched.
+     * Throw a std::error_condition exception if opening the directory fails.
+     */
+    Tree<String, InlineValues> search(const String& path);
+
+    /**
+     * Watch a directory given by its relative path, or unwatch those of
+     * the subtree rooted at it.
+     */
+    void watch(const String& path);
+    void unwatch(const String& path);
+};
+
+#endif
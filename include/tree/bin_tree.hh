@@ -4,10 +4,10 @@
 
 /* BinaryTree interface */
 
-template <typename T>
-class BinaryTree : public Tree<T>
+template <typename T, typename Storage, typename Alloc>
+class BinaryTree : public Tree<T, Storage, Alloc>
 {
-  template <typename U>
+  template <typename U, typename S, typename A>
     friend class BinaryTree; // required for BinaryTree mapping
 
   /**
@@ -25,20 +25,30 @@ class BinaryTree : public Tree<T>
    * (key, value) pairs where each value contains at most 2 keys (otherwise,
    * the resulting tree would not be binary). Failure to complying with this
    * results in an undefined behavior.
+   * The constructors from children use the allocator of the (right) child.
    */
   public:
-  BinaryTree(const T& root);
-  BinaryTree(const T& root, const BinaryTree<T>& right);
-  BinaryTree(const T& root, const BinaryTree<T>& left, \
-      const BinaryTree<T>& right);
-  BinaryTree(const Table<T>& table = {});
+  BinaryTree(const T& root, const Alloc& alloc = Alloc());
+  BinaryTree(const T& root, const BinaryTree<T, Storage, Alloc>& right);
+  BinaryTree(const T& root, const BinaryTree<T, Storage, Alloc>& left, \
+      const BinaryTree<T, Storage, Alloc>& right);
+  BinaryTree(const Table<T>& table = {}, const Alloc& alloc = Alloc());
 
   /**
    * BinaryTree mapping.
    * Override but act in the same way as the Tree<T>::map() method.
    */
   template <typename U>
-    BinaryTree<U> map(std::function<U(T)> f) const;
+    BinaryTree<U, Storage, RebindAlloc<Alloc, U>> \
+    map(std::function<U(T)> f) const;
+
+  /**
+   * Parallel BinaryTree mapping.
+   * Override but act in the same way as the Tree<T>::map_parallel() method.
+   */
+  template <typename U, typename F>
+    BinaryTree<U, Storage, RebindAlloc<Alloc, U>> \
+    map_parallel(F f, ThreadPool& pool = ThreadPool::shared()) const;
 
   /*
    * In-order search.
@@ -47,12 +57,13 @@ class BinaryTree : public Tree<T>
    */
   std::vector<Ptr<T>> in_order_search() const;
 
-  private:
   /**
-   * Perform the in-order search on the BinaryTree,
-   * but return the node ids instead of the node values.
+   * Lazy in-order traversal (see the lazy traversals of Tree<T>).
    */
-  std::vector<size_t> in_order_search_ids() const;
+  TreeRange<T, InOrder, Storage, Alloc> in_order() const;
+
+  private:
+  using typename Tree<T, Storage, Alloc>::Values;
 };
 
 #include "bin_tree.hxx" /* template class implementation */
@@ -2,106 +2,67 @@
 
 #include "bin_tree.hh" /* template class interface */
 
-template <typename T>
-BinaryTree<T>::BinaryTree(const Table<T>& table)
-  : Tree<T>(table)
+template <typename T, typename Storage, typename Alloc>
+BinaryTree<T, Storage, Alloc>::BinaryTree(const Table<T>& table, \
+    const Alloc& alloc)
+  : Tree<T, Storage, Alloc>(table, alloc)
 {}
 
-template <typename T>
-BinaryTree<T>::BinaryTree(const T& root)
-  : Tree<T>(root, {})
+template <typename T, typename Storage, typename Alloc>
+BinaryTree<T, Storage, Alloc>::BinaryTree(const T& root, \
+    const Alloc& alloc)
+  : Tree<T, Storage, Alloc>(root, {}, alloc)
 {}
 
-template <typename T>
-BinaryTree<T>::BinaryTree(const T& root, const BinaryTree<T>& right)
-  : Tree<T>(root, {right})
+template <typename T, typename Storage, typename Alloc>
+BinaryTree<T, Storage, Alloc>::BinaryTree(const T& root, \
+    const BinaryTree<T, Storage, Alloc>& right)
+  : Tree<T, Storage, Alloc>(root, {right}, right.get_allocator())
 {}
 
-template <typename T>
-BinaryTree<T>::BinaryTree(const T& root, \
-    const BinaryTree<T>& left, const BinaryTree<T>& right)
-: Tree<T>(root, {left, right})
+template <typename T, typename Storage, typename Alloc>
+BinaryTree<T, Storage, Alloc>::BinaryTree(const T& root, \
+    const BinaryTree<T, Storage, Alloc>& left, \
+    const BinaryTree<T, Storage, Alloc>& right)
+: Tree<T, Storage, Alloc>(root, {left, right}, right.get_allocator())
 {}
 
-template <typename T>
-std::vector<Ptr<T>> BinaryTree<T>::in_order_search() const
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, InOrder, Storage, Alloc>
+BinaryTree<T, Storage, Alloc>::in_order() const
 {
-  std::vector<size_t> sorted_ids = in_order_search_ids();
-  std::vector<Ptr<T>> out;
-  for (const auto& id : sorted_ids)
-    out.push_back(Tree<T>::nodes_[id].first);
-  return out;
+  return {*this};
 }
 
-template <typename T>
-std::vector<size_t> BinaryTree<T>::in_order_search_ids() const
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> BinaryTree<T, Storage, Alloc>::in_order_search() const
 {
-  /*
-   * We make the search in an iterative way, using a stack.
-   * Although it is much more natural to use recursion here, this would
-   * probably require, due to our implementation, to get at each step the
-   * children as a collection of *newly made BinaryTree* in order to apply
-   * the recursion on them, which is too expensive.
-   *
-   * We handle leaves and nodes with only 1 child as follows.
-   * First, every node has a modified id, equals to 1 + its true id.
-   * Next, we consider that all nodes have arity 2: if this is not the case,
-   * we pretend their missing children have a modified id equal to 0
-   * (NB: this shift by 1 makes all modified ids non-negative, so they may
-   * still be stored with an unsigned type).
-   * Of course, the output consists in true ids only, not modified ids.
-   */
-  if (Tree<T>::size() == 0)
-    return {};
-
-  std::stack<size_t> stack;
-  std::vector<size_t> out;
-
-  /* Start with the root. */
-  size_t id = 1; // modified id
-
-  while (true)
-  {
-    /*
-     * Push the current node id onto the stack, and replace it by its left
-     * child until we get a null id.
-     */
-    while (id)
-    {
-      stack.push(id);
-      if (Tree<T>::nodes_[id - 1].second.size() >= 4)
-        id = Tree<T>::nodes_[id - 1].second[2] + 1;
-      else
-        id = 0;
-    }
-
-    if (stack.empty())
-      break;
-
-    /*
-     * Pop one (modified id) node from the stack, add the true id to the
-     * output, and replace this node with its right child if it exists
-     * (or with a null id otherwise).
-     */
-    id = stack.top();
-    stack.pop();
-    out.push_back(id - 1);
-    if (Tree<T>::nodes_[id - 1].second.size() >= 3)
-      id = Tree<T>::nodes_[id - 1].second.back() + 1;
-    else
-      id = 0;
-  }
-
+  std::vector<Ptr<T>> out;
+  out.reserve(Tree<T, Storage, Alloc>::size());
+  auto range = in_order();
+  for (auto it = range.begin(); it != range.end(); ++it)
+    out.push_back(Values::share(Tree<T, Storage, Alloc>::values_[it.id()]));
   return out;
 }
 
-template <typename T>
+template <typename T, typename Storage, typename Alloc>
 template <typename U>
-BinaryTree<U> BinaryTree<T>::map(std::function<U(T)> f) const
+BinaryTree<U, Storage, RebindAlloc<Alloc, U>>
+BinaryTree<T, Storage, Alloc>::map(std::function<U(T)> f) const
+{
+  RebindAlloc<Alloc, U> alloc = Tree<T, Storage, Alloc>::get_allocator();
+  BinaryTree<U, Storage, RebindAlloc<Alloc, U>> tree(Table<U>(), alloc);
+  Tree<T, Storage, Alloc>::map_to(tree, f);
+  return tree;
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename U, typename F>
+BinaryTree<U, Storage, RebindAlloc<Alloc, U>>
+BinaryTree<T, Storage, Alloc>::map_parallel(F f, ThreadPool& pool) const
 {
-  BinaryTree<U> tree;
-  for (const auto& node : Tree<T>::nodes_)
-      tree.Tree<U>::nodes_.push_back(\
-          {std::make_shared<U>(f(*node.first)), node.second});
+  RebindAlloc<Alloc, U> alloc = Tree<T, Storage, Alloc>::get_allocator();
+  BinaryTree<U, Storage, RebindAlloc<Alloc, U>> tree(Table<U>(), alloc);
+  Tree<T, Storage, Alloc>::map_parallel_to(tree, f, pool);
   return tree;
 }
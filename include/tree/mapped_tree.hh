@@ -0,0 +1,370 @@
+#pragma once
+
+#include <cstddef> // std::ptrdiff_t
+#include <cstdint> // uint32_t, uint64_t
+#include <functional> // std::function
+#include <iostream> // operator<< overloading
+#include <iterator> // std::forward_iterator_tag
+#include <limits>
+#include <string>
+#include <type_traits> // std::is_trivially_copyable, std::decay
+#include <vector>
+
+#include "tree.hh"
+
+/* MappedFile interface. */
+
+/**
+ * Read-only memory mapping of a whole file, unmapped by the destructor.
+ * Mapping costs O(1) whatever the size of the file: its pages are only
+ * read from the disk (or the page cache) when they are first touched.
+ */
+class MappedFile
+{
+  public:
+    /**
+     * Constructor. Map the given file.
+     * Throw a std::system_error exception if it cannot be opened or mapped.
+     */
+    MappedFile(const std::string& file);
+
+    /// Destructor. Unmap the file.
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Move constructor and assignment: the moved file is left unmapped.
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+
+    /// Mapped bytes, and their number (the size of the file).
+    const char* data() const;
+    size_t size() const;
+
+  private:
+    const char* data_;
+    size_t size_;
+};
+
+/* Snapshot format. */
+
+/**
+ * Header of a tree snapshot (see MappedTree<T>), followed by its sections.
+ * All the numbers are in native byte order; byte_order tells a snapshot
+ * written on a machine of another endianness apart. Every section is
+ * padded with zeros to a multiple of 8 bytes:
+ * - parents, child_offsets (nb_nodes + 1 of them), children, depths,
+ *   heights and subtree_sizes: the arrays of the tree, as 64-bit ids (see
+ *   Tree<T>);
+ * - the values: for a trivially copyable type, the nb_nodes values as they
+ *   are in memory (value_size bytes each); for strings (flags & 1), the
+ *   offsets of the values in a string table (nb_nodes + 1 of them, the last
+ *   one being the size of the table), followed by the table, where every
+ *   value is null-terminated.
+ */
+struct SnapshotHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t byte_order;
+  uint64_t nb_nodes;
+  uint64_t nb_leaves;
+  uint64_t value_size;
+  uint64_t values_size;
+};
+
+/**
+ * Write the sections of a snapshot after its header into a file, through
+ * a temporary file which is then renamed; write(os) writes the sections.
+ * Throw a std::system_error exception upon failure.
+ */
+void save_snapshot(const std::string& file, const SnapshotHeader& header, \
+    const std::function<void(std::ostream&)>& write);
+
+/**
+ * Header of a snapshot with the given flags and sizes, and the current
+ * magic string, version and byte order.
+ */
+SnapshotHeader snapshot_header(uint32_t flags, uint64_t nb_nodes, \
+    uint64_t nb_leaves, uint64_t value_size, uint64_t values_size);
+
+/**
+ * Check a mapped snapshot, and return the total size of the arrays of the
+ * tree (in bytes), or throw a TreeException::InvalidSnapshot exception if
+ * the snapshot does not match the expected flags and value size, or the
+ * size of the file, or if its arrays (or its string table) are not those
+ * of a tree. It takes a single pass over the arrays, and allocates nothing.
+ */
+uint64_t check_snapshot(const MappedFile& file, uint32_t flags, \
+    uint64_t value_size);
+
+/// Write zeros after a section of the given size, up to a multiple of 8.
+void pad_section(std::ostream& os, uint64_t size);
+
+/**
+ * Traits of the values of a snapshot: the trivially copyable values are
+ * stored as they are, and read in place; the strings are stored in a
+ * string table, and read in place as null-terminated strings.
+ * - Reference: type of a value read from a snapshot;
+ * - flags: flags of the snapshot header;
+ * - size(tree): size of the values section (without padding);
+ * - write(os, tree): write the values section (without padding);
+ * - get(values, nb_nodes, id): value of a node in the values section;
+ * - make(reference): copy of a value, to build a tree.
+ */
+template <typename T>
+struct SnapshotValues
+{
+  static_assert(std::is_trivially_copyable<T>::value and alignof(T) <= 8, \
+      "snapshot values must be trivially copyable (or std::string)");
+
+  using Reference = const T&;
+  static const uint32_t flags = 0;
+
+  template <typename Storage, typename Alloc>
+  static uint64_t size(const Tree<T, Storage, Alloc>& tree);
+
+  template <typename Storage, typename Alloc>
+  static void write(std::ostream& os, const Tree<T, Storage, Alloc>& tree);
+
+  static Reference get(const char* values, size_t nb_nodes, size_t id);
+
+  static T make(Reference value);
+};
+
+template <>
+struct SnapshotValues<std::string>
+{
+  using Reference = const char*;
+  static const uint32_t flags = 1;
+
+  template <typename Storage, typename Alloc>
+  static uint64_t size(const Tree<std::string, Storage, Alloc>& tree);
+
+  template <typename Storage, typename Alloc>
+  static void write(std::ostream& os, \
+      const Tree<std::string, Storage, Alloc>& tree);
+
+  static Reference get(const char* values, size_t nb_nodes, size_t id);
+
+  static std::string make(Reference value);
+};
+
+/* MappedTreeIterator interface. */
+
+/**
+ * Same as TreeIterator<T, Order> (but for InOrder), over the nodes of a
+ * MappedTree<T> (or of the subtree rooted at a given node): the arrays of
+ * the snapshot are read in place, and dereferencing yields the value of
+ * the current node, as MappedTree<T>::value() does.
+ * The tree must outlive the iterator.
+ */
+template <typename T, typename Order>
+class MappedTreeIterator
+{
+  public:
+  /// Iterator traits (the values have no address for strings).
+  using iterator_category = std::forward_iterator_tag;
+  using reference = typename SnapshotValues<T>::Reference;
+  using value_type = typename std::decay<reference>::type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+
+  /// Past-the-end id.
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /// Constructor: past-the-end iterator.
+  MappedTreeIterator();
+
+  /**
+   * Constructor: iterator on the first node of the subtree rooted at the
+   * given node. If there is no such node, this is the past-the-end iterator.
+   */
+  MappedTreeIterator(const MappedTree<T>& tree, size_t root = 0);
+
+  /// Id of the current node.
+  size_t id() const;
+
+  /// Usual iterator operations.
+  reference operator*() const;
+  MappedTreeIterator& operator++();
+  MappedTreeIterator operator++(int);
+  bool operator==(const MappedTreeIterator& other) const;
+  bool operator!=(const MappedTreeIterator& other) const;
+
+  private:
+  /// Traversed tree, root of the traversed subtree, and current node id.
+  const MappedTree<T>* tree_;
+  size_t root_;
+  size_t id_;
+
+  /// Breadth-first traversal only: queue, as in TreeIterator<T, Order>.
+  std::vector<size_t> queue_;
+  size_t front_;
+
+  /// Go to the first node, w.r.t. each order.
+  void first(PreOrder);
+  void first(PostOrder);
+  void first(BreadthFirstOrder);
+
+  /// Go to the next node, w.r.t. each order.
+  void next(PreOrder);
+  void next(PostOrder);
+  void next(BreadthFirstOrder);
+
+  /// Go down from the current node, following the first children.
+  void descend_first_children();
+};
+
+/* MappedTreeRange interface. */
+
+/// Range of nodes of a MappedTree<T>, as TreeRange<T, Order>.
+template <typename T, typename Order>
+class MappedTreeRange
+{
+  public:
+  /// Constructor: traverse the subtree rooted at the given node.
+  MappedTreeRange(const MappedTree<T>& tree, size_t root = 0);
+
+  MappedTreeIterator<T, Order> begin() const;
+  MappedTreeIterator<T, Order> end() const;
+
+  private:
+  const MappedTree<T>* tree_;
+  size_t root_;
+};
+
+/* MappedTree interface. */
+
+/**
+ * Read-only tree mapped from a snapshot file, written by MappedTree<T>::save()
+ * from a Tree<T> (with any storage policy and allocator). The snapshot is a
+ * flat copy of the arrays of the tree (see SnapshotHeader), so loading it
+ * maps the file, and checks its header, its size and then its arrays, in a
+ * single pass: it neither parses nor allocates anything, whatever the number
+ * of nodes. The arrays are then read in place, e.g. by print().
+ * T must be trivially copyable (e.g., an integer, or a struct of them), or
+ * std::string: value() then returns a null-terminated string stored in the
+ * snapshot, instead of a std::string.
+ * The nodes have the ids of the saved tree (w.r.t. pre-order search), so a
+ * pre-order traversal is a loop over the ids, and the other ones follow
+ * child(), or the ranges below. The subtrees have no views (as SubtreeView<T>
+ * for a Tree<T>): the ranges take the id of the root of the traversed
+ * subtree instead. Snapshots are only supported on 64-bit platforms.
+ */
+template <typename T>
+class MappedTree
+{
+  static_assert(sizeof(size_t) == sizeof(uint64_t), \
+      "tree snapshots need 64-bit ids");
+
+  public:
+  /// Type of the values read from the snapshot (const T&, or const char*).
+  using Reference = typename SnapshotValues<T>::Reference;
+
+  /// Type of the values returned by the searches (T, or const char*).
+  using Value = typename std::decay<Reference>::type;
+
+  /**
+   * Constructor: map a snapshot file.
+   * Throw a std::system_error exception if it cannot be opened or mapped,
+   * and a TreeException::InvalidSnapshot exception if it is not a snapshot
+   * of a Tree<T> (wrong magic string, version, byte order, type of values
+   * or size, or inconsistent arrays).
+   */
+  MappedTree(const std::string& file);
+
+  /**
+   * Save a tree into a snapshot file; it is first written to a temporary
+   * file, which is then renamed, so an interrupted run never leaves a
+   * truncated snapshot. Throw a std::system_error exception upon failure.
+   */
+  template <typename Storage, typename Alloc>
+    static void save(const Tree<T, Storage, Alloc>& tree, \
+        const std::string& file);
+
+  /// Same as the corresponding Tree<T> methods.
+  ssize_t depth() const;
+  size_t nb_inner_nodes() const;
+  size_t nb_leaves() const;
+  size_t size() const;
+  size_t root_arity() const;
+  size_t parent(size_t id) const;
+  size_t node_depth(size_t id) const;
+
+  /**
+   * Same as the corresponding Tree<T> methods, but the companion is given
+   * the values as they are read from the snapshot (see Reference): with a
+   * companion taking a const char* (as the default one), the strings are
+   * printed without being copied.
+   */
+  template <typename Companion = TreePrintCompanion<Value>>
+    std::string to_string(const Companion& pc = {}) const;
+  template <typename Sink, typename Companion = TreePrintCompanion<Value>>
+    void print(Sink& sink, const Companion& pc = {}) const;
+
+  /**
+   * Breadth-first, post-order and pre-order searches, as for a Tree<T>;
+   * the values are copies of the trivially copyable ones, or the strings
+   * read in place.
+   */
+  std::vector<Value> breadth_first_search() const;
+  std::vector<Value> post_order_search() const;
+  std::vector<Value> pre_order_search() const;
+
+  /**
+   * Lazy traversals of the whole tree, or of the subtree rooted at a given
+   * node (the range is empty if there is no such node), as for a Tree<T>
+   * (see MappedTreeIterator<T, Order>).
+   */
+  MappedTreeRange<T, BreadthFirstOrder> breadth_first(size_t root = 0) const;
+  MappedTreeRange<T, PostOrder> post_order(size_t root = 0) const;
+  MappedTreeRange<T, PreOrder> pre_order(size_t root = 0) const;
+
+  /**
+   * Get the value of a node given by its id, read in place in the
+   * snapshot. The id is not checked.
+   */
+  Reference value(size_t id) const;
+
+  /**
+   * Number of children of a node, and id of its k-th child, given by its
+   * id. The ids are not checked.
+   */
+  size_t arity(size_t id) const;
+  size_t child(size_t id, size_t k) const;
+
+  /// Copy the whole tree into a new Tree<T> (e.g., to modify it).
+  template <typename Storage = SharedValues, \
+      typename Alloc = std::allocator<T>>
+    Tree<T, Storage, Alloc> to_tree(const Alloc& alloc = Alloc()) const;
+
+  private:
+  template <typename U, typename Order>
+    friend class MappedTreeIterator; // required for lazy traversals
+
+  /// Mapped snapshot, and its header.
+  MappedFile file_;
+  const SnapshotHeader* header_;
+
+  /// Arrays of the tree (see Tree<T>), and values section, in the snapshot.
+  const uint64_t* parents_;
+  const uint64_t* child_offsets_;
+  const uint64_t* children_;
+  const uint64_t* depths_;
+  const uint64_t* heights_;
+  const uint64_t* subtree_sizes_;
+  const char* values_;
+
+  /// Tell if a node is a leaf, or its parent's last child (as the root).
+  bool is_leaf(size_t id) const;
+  bool is_last_child(size_t id) const;
+};
+
+/// Overload the << operator for pretty-printing (see Tree<T>).
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const MappedTree<T>& tree);
+
+#include "mapped_tree.hxx" /* template class implementation */
@@ -0,0 +1,518 @@
+#pragma once
+
+#include "mapped_tree.hh" /* template class interface */
+
+#include "tree_error.hh"
+
+/* SnapshotValues implementation. */
+
+template <typename T>
+T SnapshotValues<T>::make(Reference value)
+{
+  return value;
+}
+
+template <typename T>
+typename SnapshotValues<T>::Reference
+SnapshotValues<T>::get(const char* values, size_t nb_nodes, size_t id)
+{
+  (void) nb_nodes;
+  return reinterpret_cast<const T*>(values)[id];
+}
+
+template <typename T>
+template <typename Storage, typename Alloc>
+uint64_t SnapshotValues<T>::size(const Tree<T, Storage, Alloc>& tree)
+{
+  return tree.size() * sizeof(T);
+}
+
+template <typename T>
+template <typename Storage, typename Alloc>
+void SnapshotValues<T>::write(std::ostream& os, \
+    const Tree<T, Storage, Alloc>& tree)
+{
+  /* The values are copied into a buffer, as they may be shared. */
+  std::string buffer;
+  for (size_t id = 0; id < tree.size(); id++)
+  {
+    buffer.append(reinterpret_cast<const char*>(&tree.value(id)), sizeof(T));
+    if (buffer.size() >= (1 << 16) or id + 1 == tree.size())
+    {
+      os.write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+}
+
+inline std::string SnapshotValues<std::string>::make(Reference value)
+{
+  return value;
+}
+
+inline SnapshotValues<std::string>::Reference
+SnapshotValues<std::string>::get(const char* values, size_t nb_nodes, \
+    size_t id)
+{
+  const char* table = values + (nb_nodes + 1) * sizeof(uint64_t);
+  return table + reinterpret_cast<const uint64_t*>(values)[id];
+}
+
+template <typename Storage, typename Alloc>
+uint64_t SnapshotValues<std::string>::size( \
+    const Tree<std::string, Storage, Alloc>& tree)
+{
+  uint64_t size = (tree.size() + 1) * sizeof(uint64_t);
+  for (size_t id = 0; id < tree.size(); id++)
+    size += tree.value(id).size() + 1;
+  return size;
+}
+
+template <typename Storage, typename Alloc>
+void SnapshotValues<std::string>::write(std::ostream& os, \
+    const Tree<std::string, Storage, Alloc>& tree)
+{
+  /* The offsets of the values in the table, and then the table. */
+  uint64_t offset = 0;
+  std::vector<uint64_t> offsets;
+  offsets.reserve(1 << 13);
+  for (size_t id = 0; id <= tree.size(); id++)
+  {
+    offsets.push_back(offset);
+    if (id < tree.size())
+      offset += tree.value(id).size() + 1;
+    if (offsets.size() == (1 << 13) or id == tree.size())
+    {
+      os.write(reinterpret_cast<const char*>(offsets.data()), \
+          offsets.size() * sizeof(uint64_t));
+      offsets.clear();
+    }
+  }
+  for (size_t id = 0; id < tree.size(); id++)
+    os.write(tree.value(id).c_str(), tree.value(id).size() + 1);
+}
+
+/* MappedTreeIterator implementation. */
+
+template <typename T, typename Order>
+constexpr size_t MappedTreeIterator<T, Order>::npos;
+
+template <typename T, typename Order>
+MappedTreeIterator<T, Order>::MappedTreeIterator()
+  : tree_(nullptr), root_(npos), id_(npos), front_(0)
+{}
+
+template <typename T, typename Order>
+MappedTreeIterator<T, Order>::MappedTreeIterator(const MappedTree<T>& tree, \
+    size_t root)
+  : tree_(&tree), root_(root), id_(npos), front_(0)
+{
+  if (root < tree.size())
+    first(Order{});
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::descend_first_children()
+{
+  /* In pre-order, the first child of a node comes just after it. */
+  while (!tree_->is_leaf(id_))
+    id_++;
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::first(PreOrder)
+{
+  id_ = root_;
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::first(PostOrder)
+{
+  id_ = root_;
+  descend_first_children();
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::first(BreadthFirstOrder)
+{
+  id_ = root_;
+  queue_.push_back(root_);
+}
+
+template <typename T, typename Order>
+size_t MappedTreeIterator<T, Order>::id() const
+{
+  return id_;
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::next(PreOrder)
+{
+  id_++;
+  if (id_ >= root_ + tree_->subtree_sizes_[root_])
+    id_ = npos;
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::next(PostOrder)
+{
+  /* See TreeIterator<T, PostOrder>. */
+  if (id_ == root_)
+    id_ = npos;
+  else if (tree_->is_last_child(id_))
+    id_ = tree_->parents_[id_];
+  else
+  {
+    id_ += tree_->subtree_sizes_[id_];
+    descend_first_children();
+  }
+}
+
+template <typename T, typename Order>
+void MappedTreeIterator<T, Order>::next(BreadthFirstOrder)
+{
+  /* See TreeIterator<T, BreadthFirstOrder>. */
+  size_t id = queue_[front_++];
+  for (size_t k = 0; k < tree_->arity(id); k++)
+    queue_.push_back(tree_->child(id, k));
+  if (front_ > queue_.size() / 2)
+  {
+    queue_.erase(queue_.begin(), queue_.begin() + front_);
+    front_ = 0;
+  }
+  id_ = (front_ < queue_.size()) ? queue_[front_] : npos;
+}
+
+template <typename T, typename Order>
+typename MappedTreeIterator<T, Order>::reference
+MappedTreeIterator<T, Order>::operator*() const
+{
+  return tree_->value(id_);
+}
+
+template <typename T, typename Order>
+MappedTreeIterator<T, Order>& MappedTreeIterator<T, Order>::operator++()
+{
+  next(Order{});
+  return *this;
+}
+
+template <typename T, typename Order>
+MappedTreeIterator<T, Order> MappedTreeIterator<T, Order>::operator++(int)
+{
+  auto old = *this;
+  next(Order{});
+  return old;
+}
+
+template <typename T, typename Order>
+bool MappedTreeIterator<T, Order>::operator==( \
+    const MappedTreeIterator& other) const
+{
+  return id_ == other.id_;
+}
+
+template <typename T, typename Order>
+bool MappedTreeIterator<T, Order>::operator!=( \
+    const MappedTreeIterator& other) const
+{
+  return id_ != other.id_;
+}
+
+/* MappedTreeRange implementation. */
+
+template <typename T, typename Order>
+MappedTreeRange<T, Order>::MappedTreeRange(const MappedTree<T>& tree, \
+    size_t root)
+  : tree_(&tree), root_(root)
+{}
+
+template <typename T, typename Order>
+MappedTreeIterator<T, Order> MappedTreeRange<T, Order>::begin() const
+{
+  return MappedTreeIterator<T, Order>(*tree_, root_);
+}
+
+template <typename T, typename Order>
+MappedTreeIterator<T, Order> MappedTreeRange<T, Order>::end() const
+{
+  return MappedTreeIterator<T, Order>();
+}
+
+/* MappedTree implementation. */
+
+template <typename T>
+MappedTree<T>::MappedTree(const std::string& file)
+  : file_(file)
+{
+  const uint64_t value_size = \
+    SnapshotValues<T>::flags & 1 ? 0 : sizeof(T);
+  const uint64_t arrays_size = \
+    check_snapshot(file_, SnapshotValues<T>::flags, value_size);
+  header_ = reinterpret_cast<const SnapshotHeader*>(file_.data());
+
+  /* The arrays follow the header, and the values follow the arrays. */
+  const size_t n = header_->nb_nodes;
+  parents_ = reinterpret_cast<const uint64_t*>(header_ + 1);
+  child_offsets_ = parents_ + n;
+  children_ = child_offsets_ + n + 1;
+  depths_ = children_ + (n > 0 ? n - 1 : 0);
+  heights_ = depths_ + n;
+  subtree_sizes_ = heights_ + n;
+  values_ = reinterpret_cast<const char*>(parents_) + arrays_size;
+}
+
+template <typename T>
+size_t MappedTree<T>::arity(size_t id) const
+{
+  return child_offsets_[id + 1] - child_offsets_[id];
+}
+
+template <typename T>
+std::vector<typename MappedTree<T>::Value>
+MappedTree<T>::breadth_first_search() const
+{
+  std::vector<Value> out;
+  out.reserve(size());
+  for (Reference value : breadth_first())
+    out.push_back(value);
+  return out;
+}
+
+template <typename T>
+MappedTreeRange<T, BreadthFirstOrder>
+MappedTree<T>::breadth_first(size_t root) const
+{
+  return {*this, root};
+}
+
+template <typename T>
+size_t MappedTree<T>::child(size_t id, size_t k) const
+{
+  return children_[child_offsets_[id] + k];
+}
+
+template <typename T>
+ssize_t MappedTree<T>::depth() const
+{
+  if (size() == 0)
+    return -1;
+  return static_cast<ssize_t>(heights_[0]);
+}
+
+template <typename T>
+bool MappedTree<T>::is_last_child(size_t id) const
+{
+  /* Its subtree ends with the subtree of its parent. */
+  const size_t p = parents_[id];
+  return id == 0 or id + subtree_sizes_[id] == p + subtree_sizes_[p];
+}
+
+template <typename T>
+bool MappedTree<T>::is_leaf(size_t id) const
+{
+  return child_offsets_[id + 1] == child_offsets_[id];
+}
+
+template <typename T>
+size_t MappedTree<T>::nb_inner_nodes() const
+{
+  return size() - nb_leaves();
+}
+
+template <typename T>
+size_t MappedTree<T>::nb_leaves() const
+{
+  return header_->nb_leaves;
+}
+
+template <typename T>
+size_t MappedTree<T>::node_depth(size_t id) const
+{
+  return depths_[id];
+}
+
+template <typename T>
+size_t MappedTree<T>::parent(size_t id) const
+{
+  return parents_[id];
+}
+
+template <typename T>
+std::vector<typename MappedTree<T>::Value>
+MappedTree<T>::post_order_search() const
+{
+  std::vector<Value> out;
+  out.reserve(size());
+  for (Reference value : post_order())
+    out.push_back(value);
+  return out;
+}
+
+template <typename T>
+MappedTreeRange<T, PostOrder> MappedTree<T>::post_order(size_t root) const
+{
+  return {*this, root};
+}
+
+template <typename T>
+MappedTreeRange<T, PreOrder> MappedTree<T>::pre_order(size_t root) const
+{
+  return {*this, root};
+}
+
+template <typename T>
+std::vector<typename MappedTree<T>::Value>
+MappedTree<T>::pre_order_search() const
+{
+  /* The nodes are stored w.r.t. pre-order search. */
+  std::vector<Value> out;
+  out.reserve(size());
+  for (size_t id = 0; id < size(); id++)
+    out.push_back(value(id));
+  return out;
+}
+
+template <typename T>
+template <typename Sink, typename Companion>
+void MappedTree<T>::print(Sink& sink, const Companion& pc) const
+{
+  if (size() == 0)
+    return;
+
+  /*
+   * Same as Tree<T>::print(), reading the arrays of the snapshot; the values
+   * are given to the companion as they are read (see value()).
+   */
+  std::string line;
+  append_label(line, pc.print_root(), value(0));
+  line += '\n';
+  sink.write(line.data(), line.size());
+
+  std::string hline;
+  for (unsigned i = 0; i < pc.dashes(); i++)
+    hline += "\u2500"; // ─
+  std::string spaces(pc.spaces(), ' ');
+  auto tab = std::string(pc.dashes(), ' ') + spaces;
+  auto hook_tail = "\u2514" + hline + spaces; // └
+  auto tee_tail = "\u251c" + hline + spaces; // ├
+  auto vline_column = "\u2502" + tab; // │
+  auto blank_column = " " + tab;
+
+  std::string prefix;
+  std::vector<size_t> prefix_sizes(heights_[0] + 1, 0);
+  for (size_t i = 1; i < size(); i++)
+  {
+    size_t depth = depths_[i];
+    prefix.resize(prefix_sizes[depth - 1]);
+    line = prefix;
+    const bool last = is_last_child(i);
+    line += last ? hook_tail : tee_tail;
+
+    const Reference t = value(i);
+    if (is_leaf(i))
+      append_label(line, pc.print_leaf(), t);
+    else
+    {
+      append_label(line, pc.print_node(), t);
+      prefix += last ? blank_column : vline_column; // for the descendants
+      prefix_sizes[depth] = prefix.size();
+    }
+    line += '\n';
+    sink.write(line.data(), line.size());
+  }
+}
+
+template <typename T>
+size_t MappedTree<T>::root_arity() const
+{
+  if (size() == 0)
+    throw TreeException::EmptyTree("[ERROR]" \
+        " Calling MappedTree<T>::root_arity() failed: Empty tree\n");
+  return arity(0);
+}
+
+template <typename T>
+template <typename Storage, typename Alloc>
+void MappedTree<T>::save(const Tree<T, Storage, Alloc>& tree, \
+    const std::string& file)
+{
+  const uint64_t n = tree.size();
+  const uint64_t value_size = \
+    SnapshotValues<T>::flags & 1 ? 0 : sizeof(T);
+  const uint64_t values_size = SnapshotValues<T>::size(tree);
+  const SnapshotHeader header = snapshot_header(SnapshotValues<T>::flags, \
+      n, tree.nb_leaves(), value_size, values_size);
+
+  save_snapshot(file, header, [&tree, n, values_size](std::ostream& os)
+      {
+        auto write = [&os](const size_t* ids, size_t size)
+        {
+          os.write(reinterpret_cast<const char*>(ids), size * sizeof(size_t));
+        };
+        const size_t zero = 0;
+        write(tree.parents_.data(), n);
+        if (n > 0)
+          write(tree.child_offsets_.data(), n + 1);
+        else // the empty tree has no offset
+          write(&zero, 1);
+        write(tree.children_.data(), tree.children_.size());
+        write(tree.depths_.data(), n);
+        write(tree.heights_.data(), n);
+        write(tree.subtree_sizes_.data(), n);
+        SnapshotValues<T>::write(os, tree);
+        pad_section(os, values_size);
+      });
+}
+
+template <typename T>
+size_t MappedTree<T>::size() const
+{
+  return header_->nb_nodes;
+}
+
+template <typename T>
+template <typename Storage, typename Alloc>
+Tree<T, Storage, Alloc> MappedTree<T>::to_tree(const Alloc& alloc) const
+{
+  using Values = typename Tree<T, Storage, Alloc>::Values;
+
+  Tree<T, Storage, Alloc> tree(Table<T>(), alloc);
+  const size_t n = size();
+  if (n == 0)
+    return tree;
+  tree.parents_.assign(parents_, parents_ + n);
+  tree.child_offsets_.assign(child_offsets_, child_offsets_ + n + 1);
+  tree.children_.assign(children_, children_ + n - 1);
+  tree.values_.reserve(n);
+  for (size_t id = 0; id < n; id++)
+    tree.values_.push_back( \
+        Values::make(SnapshotValues<T>::make(value(id)), alloc));
+  tree.index_nodes();
+  return tree;
+}
+
+template <typename T>
+template <typename Companion>
+std::string MappedTree<T>::to_string(const Companion& pc) const
+{
+  std::string s;
+  StringSink sink(s);
+  print(sink, pc);
+  return s;
+}
+
+template <typename T>
+typename MappedTree<T>::Reference MappedTree<T>::value(size_t id) const
+{
+  return SnapshotValues<T>::get(values_, size(), id);
+}
+
+/* Operator overloading. */
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const MappedTree<T>& tree)
+{
+  tree.print(os);
+  return os;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <iostream> // operator<< overloading
+#include <string>
+#include <vector>
+
+#include "tree.hh"
+
+/* SubtreeView interface. */
+
+/**
+ * Lightweight, read-only view of the subtree of a Tree<T> rooted at a given
+ * node. Recall that nodes are stored w.r.t. pre-order search, so the nodes
+ * of a subtree have consecutive ids: a view is merely the (tree, begin, end)
+ * range of these ids, and nothing is copied nor renumbered.
+ * Hence, walking down a tree with SubtreeView<T>::root_children() costs O(1)
+ * per child, whereas Tree<T>::root_children() copies every subtree.
+ * The viewed tree must outlive the view.
+ */
+template <typename T, typename Storage = SharedValues, \
+    typename Alloc = std::allocator<T>>
+class SubtreeView
+{
+  public:
+  /**
+   * Constructor: view the subtree rooted at the node with the given id
+   * (by default, the whole tree).
+   * If the id is invalid (out of range), throw a TreeException::NoSuchNode
+   * exception, unless the tree is empty and the id is 0: in this case, the
+   * view is empty too.
+   */
+  SubtreeView(const Tree<T, Storage, Alloc>& tree, size_t root = 0);
+
+  /// Range of the node ids in the viewed tree: [begin(), end()).
+  size_t begin() const;
+  size_t end() const;
+
+  /// Same as the corresponding Tree<T> methods, for the subtree.
+  ssize_t depth() const;
+  size_t nb_inner_nodes() const;
+  size_t nb_leaves() const;
+  size_t size() const;
+  size_t root_arity() const;
+  Ptr<T> root_value() const;
+  std::vector<Ptr<T>> breadth_first_search() const;
+  std::vector<Ptr<T>> post_order_search() const;
+  std::vector<Ptr<T>> pre_order_search() const;
+  template <typename Companion = TreePrintCompanion<T>>
+    std::string to_string(const Companion& pc = {}) const;
+  template <typename Sink, typename Companion = TreePrintCompanion<T>>
+    void print(Sink& sink, const Companion& pc = {}) const;
+  TreeRange<T, BreadthFirstOrder, Storage, Alloc> breadth_first() const;
+  TreeRange<T, PostOrder, Storage, Alloc> post_order() const;
+  TreeRange<T, PreOrder, Storage, Alloc> pre_order() const;
+
+  /**
+   * Get a view of the k-th child of the root.
+   * If there is no such child, throw a TreeException::NoSuchNode exception.
+   */
+  SubtreeView<T, Storage, Alloc> child(size_t k) const;
+
+  /**
+   * Get the children of the root, as a vector of views.
+   * If the view is empty, throw a TreeException::EmptyTree exception.
+   */
+  std::vector<SubtreeView<T, Storage, Alloc>> root_children() const;
+
+  /// Copy the subtree into a new tree.
+  Tree<T, Storage, Alloc> to_tree() const;
+
+  private:
+  /// Viewed tree.
+  const Tree<T, Storage, Alloc>* tree_;
+
+  /// Range of the node ids of the subtree.
+  size_t begin_;
+  size_t end_;
+
+  /// Storage policy traits for the node values.
+  using Values = ValueStorage<T, Storage>;
+};
+
+/// Overload the << operator for pretty-printing (see Tree<T>).
+template <typename T, typename Storage, typename Alloc>
+std::ostream& operator<<(std::ostream& os, \
+    const SubtreeView<T, Storage, Alloc>& view);
+
+#include "subtree_view.hxx" /* template class implementation */
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "subtree_view.hh" /* template class interface */
+
+#include "tree_error.hh"
+
+template <typename T, typename Storage, typename Alloc>
+SubtreeView<T, Storage, Alloc>::SubtreeView( \
+    const Tree<T, Storage, Alloc>& tree, size_t root)
+  : tree_(&tree), begin_(root), end_(root)
+{
+  if (root < tree.size())
+    end_ = root + tree.subtree_sizes_[root];
+  else if (root != 0 or tree.size() != 0)
+    throw TreeException::NoSuchNode("[ERROR]" \
+        " Calling SubtreeView<T>::SubtreeView() failed: Invalid node id\n");
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t SubtreeView<T, Storage, Alloc>::begin() const
+{
+  return begin_;
+}
+
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> SubtreeView<T, Storage, Alloc>::breadth_first_search() const
+{
+  if (size() == 0)
+    return {};
+
+  std::vector<Ptr<T>> out;
+  out.reserve(size());
+  auto range = breadth_first();
+  for (auto it = range.begin(); it != range.end(); ++it)
+    out.push_back(Values::share(tree_->values_[it.id()]));
+  return out;
+}
+
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, BreadthFirstOrder, Storage, Alloc>
+SubtreeView<T, Storage, Alloc>::breadth_first() const
+{
+  if (size() == 0)
+    return {*tree_, tree_->size()}; // empty range
+  return {*tree_, begin_};
+}
+
+template <typename T, typename Storage, typename Alloc>
+SubtreeView<T, Storage, Alloc>
+SubtreeView<T, Storage, Alloc>::child(size_t k) const
+{
+  if (size() == 0 or k >= root_arity())
+    throw TreeException::NoSuchNode("[ERROR]" \
+        " Calling SubtreeView<T>::child() failed: No such child\n");
+  return SubtreeView<T, Storage, Alloc>(*tree_, tree_->child(begin_, k));
+}
+
+template <typename T, typename Storage, typename Alloc>
+ssize_t SubtreeView<T, Storage, Alloc>::depth() const
+{
+  if (size() == 0)
+    return -1;
+  return static_cast<ssize_t>(tree_->heights_[begin_]);
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t SubtreeView<T, Storage, Alloc>::end() const
+{
+  return end_;
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t SubtreeView<T, Storage, Alloc>::nb_inner_nodes() const
+{
+  return size() - nb_leaves();
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t SubtreeView<T, Storage, Alloc>::nb_leaves() const
+{
+  if (size() == 0)
+    return 0;
+  return tree_->subtree_leaves_[begin_];
+}
+
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> SubtreeView<T, Storage, Alloc>::post_order_search() const
+{
+  if (size() == 0)
+    return {};
+
+  std::vector<Ptr<T>> out;
+  out.reserve(size());
+  auto range = post_order();
+  for (auto it = range.begin(); it != range.end(); ++it)
+    out.push_back(Values::share(tree_->values_[it.id()]));
+  return out;
+}
+
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, PostOrder, Storage, Alloc>
+SubtreeView<T, Storage, Alloc>::post_order() const
+{
+  if (size() == 0)
+    return {*tree_, tree_->size()}; // empty range
+  return {*tree_, begin_};
+}
+
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, PreOrder, Storage, Alloc>
+SubtreeView<T, Storage, Alloc>::pre_order() const
+{
+  if (size() == 0)
+    return {*tree_, tree_->size()}; // empty range
+  return {*tree_, begin_};
+}
+
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> SubtreeView<T, Storage, Alloc>::pre_order_search() const
+{
+  /* The subtree nodes are already stored w.r.t. pre-order search. */
+  std::vector<Ptr<T>> out;
+  out.reserve(size());
+  for (size_t i = begin_; i < end_; i++)
+    out.push_back(Values::share(tree_->values_[i]));
+  return out;
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename Sink, typename Companion>
+void SubtreeView<T, Storage, Alloc>::print(Sink& sink, \
+    const Companion& pc) const
+{
+  if (size() > 0)
+    tree_->print_subtree(sink, begin_, pc);
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t SubtreeView<T, Storage, Alloc>::root_arity() const
+{
+  if (size() == 0)
+    throw TreeException::EmptyTree("[ERROR]" \
+        " Calling SubtreeView<T>::root_arity() failed: Empty tree\n");
+  return tree_->arity(begin_);
+}
+
+template <typename T, typename Storage, typename Alloc>
+std::vector<SubtreeView<T, Storage, Alloc>>
+SubtreeView<T, Storage, Alloc>::root_children() const
+{
+  if (size() == 0)
+    throw TreeException::EmptyTree("[ERROR]" \
+        " Calling SubtreeView<T>::root_children() failed: Empty tree\n");
+
+  std::vector<SubtreeView<T, Storage, Alloc>> out;
+  out.reserve(root_arity());
+  for (size_t k = 0; k < root_arity(); k++)
+    out.push_back( \
+        SubtreeView<T, Storage, Alloc>(*tree_, tree_->child(begin_, k)));
+  return out;
+}
+
+template <typename T, typename Storage, typename Alloc>
+Ptr<T> SubtreeView<T, Storage, Alloc>::root_value() const
+{
+  if (size() == 0)
+    throw TreeException::EmptyTree("[ERROR]" \
+        " Calling SubtreeView<T>::root_value() failed: Empty tree\n");
+  return Values::share(tree_->values_[begin_]);
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t SubtreeView<T, Storage, Alloc>::size() const
+{
+  return end_ - begin_;
+}
+
+template <typename T, typename Storage, typename Alloc>
+Tree<T, Storage, Alloc> SubtreeView<T, Storage, Alloc>::to_tree() const
+{
+  if (size() == 0)
+    return {};
+  return tree_->subtree(begin_);
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename Companion>
+std::string SubtreeView<T, Storage, Alloc>::to_string(const Companion& pc) const
+{
+  std::string s;
+  StringSink sink(s);
+  print(sink, pc);
+  return s;
+}
+
+/* Operator overloading. */
+
+template <typename T, typename Storage, typename Alloc>
+std::ostream& operator<<(std::ostream& os, \
+    const SubtreeView<T, Storage, Alloc>& view)
+{
+  view.print(os);
+  return os;
+}
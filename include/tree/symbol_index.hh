@@ -0,0 +1,61 @@
+#pragma once
+
+#include <functional> // std::hash, std::reference_wrapper
+#include <memory> // std::shared_ptr
+#include <type_traits>
+#include <unordered_map>
+#include <utility> // std::declval
+#include <vector>
+
+/**
+ * Type trait telling whether std::hash<T> is available (i.e., whether T can
+ * be used as a key in a std::unordered_map).
+ */
+template <typename T, typename = void>
+struct is_hashable : std::false_type
+{};
+
+template <typename T>
+struct is_hashable<T, decltype(\
+    (void) std::hash<T>{}(std::declval<const T&>()))> : std::true_type
+{};
+
+/* SymbolIndex interface. */
+
+/**
+ * Helper class for Tree<T>::Tree(const Table<T>& table): find the id
+ * (=index in the table) of the node given by a pointer to its value.
+ * A pointer to a key of the table is resolved by its address, in O(1)
+ * expected time. Otherwise, the pointed value is looked up among the keys
+ * with operator==: through a hash table if std::hash<T> is available
+ * (in O(1) expected time, the hash table being built on the first lookup
+ * only), and by a linear scan otherwise.
+ * In all cases, the id of the first key having this value is returned, or
+ * the number of keys if there is no such key.
+ */
+template <typename T, bool Hashable = is_hashable<T>::value>
+class SymbolIndex
+{
+  public:
+    /// Constructor. The keys must outlive the index.
+    SymbolIndex(const std::vector<std::shared_ptr<T>>& keys);
+
+    /// Return the id of the given symbol, or the number of keys if not found.
+    size_t find(const std::shared_ptr<T>& symbol);
+
+  private:
+    /// Keys (node values) of the table.
+    const std::vector<std::shared_ptr<T>>& keys_;
+
+    /// Ids of the keys, indexed by their addresses.
+    std::unordered_map<const T*, size_t> by_address_;
+
+    /// Ids of the keys, indexed by their values (built on demand).
+    std::unordered_map<std::reference_wrapper<const T>, size_t, \
+      std::hash<T>, std::equal_to<T>> by_value_;
+
+    /// Look up a value which is not the address of a key.
+    size_t find_value(const T& value);
+};
+
+#include "symbol_index.hxx" /* template class implementation */
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "symbol_index.hh" /* template class interface */
+
+template <typename T, bool Hashable>
+SymbolIndex<T, Hashable>::SymbolIndex(\
+    const std::vector<std::shared_ptr<T>>& keys)
+  : keys_(keys)
+{
+  by_address_.reserve(keys_.size());
+  for (size_t i = 0; i < keys_.size(); i++)
+    by_address_.emplace(keys_[i].get(), i); // keep the first id only
+}
+
+template <typename T, bool Hashable>
+size_t SymbolIndex<T, Hashable>::find(const std::shared_ptr<T>& symbol)
+{
+  auto it = by_address_.find(symbol.get());
+  if (it != by_address_.end())
+    return it->second;
+  return find_value(*symbol);
+}
+
+template <typename T, bool Hashable>
+size_t SymbolIndex<T, Hashable>::find_value(const T& value)
+{
+  /* Build the hash table on the first lookup by value. */
+  if (by_value_.empty())
+  {
+    by_value_.reserve(keys_.size());
+    for (size_t i = 0; i < keys_.size(); i++)
+      by_value_.emplace(std::cref(*keys_[i]), i); // keep the first id only
+  }
+
+  auto it = by_value_.find(std::cref(value));
+  return (it == by_value_.end()) ? keys_.size() : it->second;
+}
+
+/**
+ * Partial specialization for types without std::hash: the values are looked
+ * up with a linear scan.
+ */
+template <typename T>
+class SymbolIndex<T, false>
+{
+  public:
+    SymbolIndex(const std::vector<std::shared_ptr<T>>& keys)
+      : keys_(keys)
+    {
+      by_address_.reserve(keys_.size());
+      for (size_t i = 0; i < keys_.size(); i++)
+        by_address_.emplace(keys_[i].get(), i);
+    }
+
+    size_t find(const std::shared_ptr<T>& symbol)
+    {
+      auto it = by_address_.find(symbol.get());
+      if (it != by_address_.end())
+        return it->second;
+
+      size_t j = 0;
+      while (j < keys_.size() and not (*keys_[j] == *symbol))
+        j++;
+      return j;
+    }
+
+  private:
+    const std::vector<std::shared_ptr<T>>& keys_;
+    std::unordered_map<const T*, size_t> by_address_;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef> // std::size_t
+#include <deque>
+#include <exception> // std::exception_ptr
+#include <functional> // std::function
+#include <memory> // std::unique_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* ThreadPool interface. */
+
+/**
+ * Work-stealing thread pool, used by the parallel tree algorithms (e.g.,
+ * Tree<T>::map_parallel()).
+ * Every worker thread owns a queue of tasks: it pops its own tasks in LIFO
+ * order (so that the tasks it has just submitted are run while still hot in
+ * cache), and steals the oldest tasks of the other workers in FIFO order
+ * when its queue is empty. Tasks submitted by a worker go to its own queue,
+ * and the others are dealt to the queues in turn.
+ * The worker threads are started on the first submitted task, so that an
+ * unused pool costs nothing.
+ * Every task belongs to a group (see TaskGroup), and wait(group) blocks
+ * until the tasks of the group (including the tasks they submit
+ * themselves) are done; the waiting thread runs tasks meanwhile (of any
+ * group). So several threads may wait on their own groups at the same
+ * time, and a task may itself submit tasks to a new group and wait on it
+ * (e.g., a nested parallel algorithm).
+ */
+class ThreadPool
+{
+  public:
+    /**
+     * Constructor. Use the given number of worker threads, or by default
+     * as many as hardware threads (at least one).
+     */
+    ThreadPool(size_t nb_threads = 0);
+
+    /// Destructor. Run the remaining tasks, and join the worker threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Group of tasks, waited on together, with the first exception thrown
+     * by any of them. It must be waited on before being destroyed.
+     */
+    class TaskGroup
+    {
+      public:
+        TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+      private:
+        friend ThreadPool;
+
+        /// Number of tasks submitted but not done yet.
+        std::atomic<size_t> unfinished_;
+
+        /// First exception thrown by a task (protected by the pool mutex).
+        std::exception_ptr error_;
+    };
+
+    /// Process-wide pool, with as many worker threads as hardware threads.
+    static ThreadPool& shared();
+
+    /// Number of worker threads.
+    size_t nb_threads() const;
+
+    /**
+     * Submit a task to a group: by default, the group of the task calling
+     * submit() if any, or else the default group of the pool.
+     */
+    void submit(std::function<void()> task);
+    void submit(std::function<void()> task, TaskGroup& group);
+
+    /**
+     * Wait until all the tasks of a group (by default, the default group of
+     * the pool) are done. If some of them threw exceptions, rethrow the
+     * first one. A task must not wait on its own group.
+     */
+    void wait();
+    void wait(TaskGroup& group);
+
+    /**
+     * Split the range [0, n) into chunks of (at least) grain indices, call
+     * f(begin, end) on every chunk [begin, end) in parallel, and wait (on a
+     * group of its own, so it may be called by several threads at once, or
+     * from a task).
+     * If there is only one chunk, f is called directly by this thread.
+     */
+    template <typename F>
+      void parallel_for(size_t n, size_t grain, F f);
+
+  private:
+    /// Task, and its group.
+    struct Task
+    {
+      std::function<void()> run;
+      TaskGroup* group;
+    };
+
+    /// Queue of tasks owned by a worker thread.
+    struct Queue
+    {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    size_t nb_threads_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    /**
+     * mutex_ protects stop_, nb_waiting_ and the errors of the groups, and
+     * the waits on wake_ (notified on new tasks, for the workers) and done_
+     * (notified on new tasks and when a group is done, for the threads in
+     * wait()).
+     * queued_: number of tasks in the queues; nb_waiting_: number of threads
+     * sleeping in wait(); next_queue_: queue for the next task submitted
+     * from outside the pool; group_: default group.
+     */
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::atomic<size_t> queued_;
+    size_t nb_waiting_;
+    std::atomic<size_t> next_queue_;
+    bool stop_;
+    TaskGroup group_;
+    std::once_flag started_;
+
+    /// Start the worker threads.
+    void start();
+
+    /**
+     * Pop a task from the given queue (if it is a valid id), or steal one
+     * from the other queues, and run it. Return false if no task was found.
+     */
+    bool run_one(size_t self);
+
+    /// Main loop of the worker thread owning the given queue.
+    void work(size_t self);
+};
+
+#include "thread_pool.hxx" /* template class implementation */
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "thread_pool.hh" /* template class interface */
+
+template <typename F>
+void ThreadPool::parallel_for(size_t n, size_t grain, F f)
+{
+  if (grain == 0)
+    grain = 1;
+  if (n <= grain)
+  {
+    if (n > 0)
+      f(0, n);
+    return;
+  }
+
+  TaskGroup group;
+  for (size_t begin = 0; begin < n; begin += grain)
+  {
+    size_t end = (n - begin > grain) ? begin + grain : n;
+    submit([&f, begin, end]() { f(begin, end); }, group);
+  }
+  wait(group);
+}
@@ -6,42 +6,74 @@
 #include <string>
 #include <vector>
 
+#include "tree_iterator.hh"
 #include "tree_pc.hh"
+#include "tree_sink.hh"
+#include "tree_storage.hh"
+#include "thread_pool.hh"
 
 /**
  * Type aliases.
  * Ptr<T>: shared pointers to T objects.
- * Node<T>: node in the tree.
- * Nodes<T>: vector of the nodes forming the tree.
+ * Ids: vector of node ids, used for the flat storage of the tree structure
+ * (with the default allocator; trees use their own allocator).
  * Table<T>: table used for tree building:
  * see Tree<T>::Tree(const Table<T>& table) below.
  */
 template <typename T>
 using Ptr = std::shared_ptr<T>;
 
-template <typename T>
-using Node = std::pair<Ptr<T>, std::vector<size_t>>;
-
-template <typename T>
-using Nodes = std::vector<Node<T>>;
+using Ids = std::vector<size_t>;
 
 template <typename T>
 using Table = std::vector<std::pair<Ptr<T>, std::vector<Ptr<T>>>>;
 
-/* Tree interface. */
+/*
+ * Tree interface.
+ * The Storage parameter selects how the node values are stored (please
+ * refer to the "tree_storage.hh" header file): by default, behind shared
+ * pointers (SharedValues), or by value (InlineValues).
+ * The Alloc parameter is the allocator used for all the storage of the tree
+ * (std::allocator<T> by default). Every constructor takes an optional
+ * allocator as last argument, and the trees derived from a tree (by mapping,
+ * root_children(), ...) use the same allocator. With an ArenaAllocator, a
+ * tree built and dropped in bulk costs only a few allocations in the arena,
+ * and its memory is freed at once with the arena (please refer to the
+ * "tree_arena.hh" header file).
+ */
 
-template <typename T>
+template <typename T, typename Storage, typename Alloc>
 class Tree
 {
+  template <typename U, typename S, typename A>
+    friend class Tree; // required for tree mapping and conversions
+  template <typename U, typename S, typename A>
+    friend class TreeBuilder; // required for bottom-up tree building
+  template <typename U, typename S, typename A>
+    friend class SubtreeView; // required for subtree views
+  template <typename U, typename Order, typename S, typename A>
+    friend class TreeIterator; // required for lazy traversals
   template <typename U>
-    friend class Tree; // required for tree mapping
+    friend class MappedTree; // required for snapshots
 
   public:
   /**
    * Bottom-to-top constructor: provide a reference to the label for the new
    * root, along with the children (as Trees) in a vector.
    */
-  Tree(const T& root, const std::vector<Tree<T>>& children = {});
+  Tree(const T& root, \
+      const std::vector<Tree<T, Storage, Alloc>>& children = {}, \
+      const Alloc& alloc = Alloc());
+
+  /**
+   * Same as above, but the children are moved into the new tree instead of
+   * being copied (they are left empty).
+   * To build a large tree bottom-up, prefer the TreeBuilder class, as every
+   * call to this constructor still takes a time linear in the size of the
+   * new tree.
+   */
+  Tree(T root, std::vector<Tree<T, Storage, Alloc>>&& children, \
+      const Alloc& alloc = Alloc());
 
   /**
    * Top-to-bottom constructor: construct a tree from a table.
@@ -54,7 +86,14 @@ class Tree
    * corresponding to values in the table must point to distinct objects too.
    * To check equality between pointed values, the type T must be endowed with
    * an overloaded == operator.
-   * The first pair in the table corresponds to the root and its children.
+   * Children are first resolved by pointer identity: if a pointer in a value
+   * is also a key in the table, no comparison is made at all. Otherwise,
+   * they are resolved by std::hash<T> if available, and by a linear scan
+   * of the keys if not (see the SymbolIndex class). Hence, the construction
+   * takes a linear expected time in the first two cases.
+   * The first pair in the table corresponds to the root and its children,
+   * and the next pairs must follow the pre-order search (so that every node
+   * comes after its parent).
    * All leaves must appear in the table as (key, value) pairs, with value
    * being the empty vector.
    * It falls to the caller's duty to provide a valid table, as the constructor
@@ -68,7 +107,19 @@ class Tree
    * and finally use tree mapping (with a custom map node id->node value) to
    * construct the tree you want.
    **/
-  Tree(const Table<T>& table = {});
+  Tree(const Table<T>& table = {}, const Alloc& alloc = Alloc());
+
+  /**
+   * Conversion between storage policies, e.g. from a tree with shared values
+   * to a tree with inline values (or conversely). The structure is copied
+   * as is, and every value is copied once. The new tree uses the same
+   * allocator.
+   */
+  template <typename S>
+    explicit Tree(const Tree<T, S, Alloc>& tree);
+
+  /// Get a copy of the allocator of the tree.
+  Alloc get_allocator() const;
 
   /// Depth (=height) of the tree. Equals -1 for an empty tree.
   ssize_t depth() const;
@@ -92,7 +143,7 @@ class Tree
    * Get the children of the root, as a vector of new trees.
    * If the tree is empty, throw a TreeException::EmptyTree exception.
    */
-  std::vector<Tree<T>> root_children() const;
+  std::vector<Tree<T, Storage, Alloc>> root_children() const;
 
   /**
    * Get a shared pointer to the value (label) of the root.
@@ -100,12 +151,96 @@ class Tree
    */
   Ptr<T> root_value() const;
 
+  /**
+   * Get a reference to the value (label) of a node given by its id
+   * (i.e., its rank w.r.t. pre-order search). The id is not checked.
+   * Unlike root_value(), this never touches any reference count.
+   */
+  const T& value(size_t id) const;
+
+  /**
+   * Get the id of the parent, and the depth, of a node given by its id
+   * (the root is its own parent, and has depth 0). The id is not checked.
+   */
+  size_t parent(size_t id) const;
+  size_t node_depth(size_t id) const;
+
+  /**
+   * Insert a copy of a tree as the k-th child of a node given by its id
+   * (k = its arity appends it as the last child). The nodes after it are
+   * renumbered, so the ids of the nodes of the inserted copy are
+   * [id', id' + subtree.size()), where id' is the id of the former k-th
+   * child (or the id following the subtree of the parent).
+   * Remove the subtree rooted at a node given by its id, or the subtrees
+   * rooted at several nodes at once (which may be nested); the nodes after
+   * them are renumbered. Removing the root empties the tree.
+   * All take a linear time in the size of the tree (the structural metadata
+   * are computed again), so removing many subtrees is faster at once. The
+   * values are copied (or shared, with shared values) from the inserted
+   * tree, which may be the tree itself (it is then copied first).
+   * If there is no such node (or no such position for the inserted tree),
+   * throw a TreeException::NoSuchNode exception.
+   * For a BinaryTree<T>, it falls to the caller's duty to keep at most 2
+   * children per node.
+   */
+  void insert_subtree(size_t parent, size_t k, \
+      const Tree<T, Storage, Alloc>& subtree);
+  void remove_subtree(size_t id);
+  void remove_subtrees(Ids ids);
+
   /**
    * Tree mapping: apply a map f to all nodes of the tree.
    * The result is a new tree with same shape.
    */
   template <typename U>
-    Tree<U> map(std::function<U(T)> f) const;
+    Tree<U, Storage, RebindAlloc<Alloc, U>> \
+    map(std::function<U(T)> f) const;
+
+  /**
+   * Parallel tree mapping: same as map(), but the nodes are split into
+   * contiguous ranges of ids, mapped in parallel by the threads of a pool,
+   * and the results are written in place into the new tree (so the order of
+   * the nodes is the same as with map()). f is any callable object taking a
+   * const T& and returning a U; it is called concurrently, and must not
+   * modify any shared state (but it may itself use the pool, which may also
+   * be used by other threads at the same time; see ThreadPool).
+   * With inline values, U must be default-constructible. With shared
+   * values, the allocator must be thread-safe (std::allocator is, but
+   * ArenaAllocator is not).
+   */
+  template <typename U, typename F>
+    Tree<U, Storage, RebindAlloc<Alloc, U>> \
+    map_parallel(F f, ThreadPool& pool = ThreadPool::shared()) const;
+
+  /**
+   * Bottom-up subtree reduction (fold): compute an aggregate of type R for
+   * the subtree rooted at every node, from the value of the node and the
+   * aggregates of its children. The aggregate of a node is first set to
+   * init(value), and then the aggregates of its children are folded into
+   * it, in order, by combine(aggregate, child_aggregate), which modifies
+   * its first argument. For instance, the sums of all subtrees are given by
+   * reduce_subtrees<long>([](const T& x) { return x; },
+   *     [](long& sum, const long& child_sum) { sum += child_sum; }).
+   * Return the aggregates in a vector indexed by node ids (so the aggregate
+   * of the whole tree comes first). R must be default-constructible.
+   * The nodes are visited once, in reverse pre-order (so that children come
+   * before their parents).
+   */
+  template <typename R, typename Init, typename Combine>
+    std::vector<R> reduce_subtrees(Init init, Combine combine) const;
+
+  /**
+   * Parallel version of reduce_subtrees(), with the same result. The
+   * subtrees which are small enough (about size() / (8 * nb_threads) nodes
+   * at most) are reduced as independent tasks on the pool, which balances
+   * them by work stealing; then the nodes above them are reduced. init and
+   * combine are called concurrently, and must not modify any shared state.
+   * R must not be bool (as an std::vector<bool> cannot be written
+   * concurrently).
+   */
+  template <typename R, typename Init, typename Combine>
+    std::vector<R> reduce_subtrees_parallel(Init init, Combine combine, \
+        ThreadPool& pool = ThreadPool::shared()) const;
 
   /**
    * Breadth-first search (BFS).
@@ -125,6 +260,17 @@ class Tree
    */
  std::vector<Ptr<T>> pre_order_search() const;
 
+  /**
+   * Lazy traversals: breadth-first, post-order and pre-order ranges of
+   * nodes, to be used e.g. in range-based for loops. Unlike the above
+   * searches, nothing is allocated beforehand, and the iterators yield
+   * references to the node values (and the node ids, with their id() method).
+   * Please refer to the TreeIterator class for more details.
+   */
+  TreeRange<T, BreadthFirstOrder, Storage, Alloc> breadth_first() const;
+  TreeRange<T, PostOrder, Storage, Alloc> post_order() const;
+  TreeRange<T, PreOrder, Storage, Alloc> pre_order() const;
+
   /**
    * Developper-friendly representation of the tree
    * (equivalent of Python's __repr__()).
@@ -133,8 +279,11 @@ class Tree
    * The TreePrintCompanion specifies how the leaves, inner
    * nodes and root must be represented;
    * please refer to the documentation of that class for more details.
+   * A TreePrintPolicy can be used instead of a TreePrintCompanion, here and
+   * in the other printing methods below.
    */
-  std::string represent(const TreePrintCompanion<T>& pc = {}) const;
+  template <typename Companion = TreePrintCompanion<T>>
+    std::string represent(const Companion& pc = {}) const;
 
   /**
    * User-friendly representation of the tree
@@ -146,21 +295,88 @@ class Tree
    * be spaced;
    * please refer to the documentation of that class for more details.
    */
-  std::string to_string(const TreePrintCompanion<T>& pc = {}) const;
+  template <typename Companion = TreePrintCompanion<T>>
+    std::string to_string(const Companion& pc = {}) const;
+
+  /**
+   * Streaming version of to_string(): write the same representation to a
+   * sink, line by line, such as an std::ostream (please refer to the
+   * "tree_sink.hh" header file for more details).
+   * Apart from the current line, only the prefix of vertical lines is kept
+   * in memory, so the memory used only depends on the depth of the tree.
+   */
+  template <typename Sink, typename Companion = TreePrintCompanion<T>>
+    void print(Sink& sink, const Companion& pc = {}) const;
 
   protected:
+  /// Storage policy traits for the node values.
+  using Values = ValueStorage<T, Storage>;
+
+  /// Arrays of node values, node ids and flags, using the tree allocator.
+  using NodeValues = std::vector<typename Values::Value, \
+        RebindAlloc<Alloc, typename Values::Value>>;
+  using NodeIds = std::vector<size_t, RebindAlloc<Alloc, size_t>>;
+  using NodeFlags = std::vector<bool, RebindAlloc<Alloc, bool>>;
+
   /**
-   * The nodes of the tree, stored in a vector.
-   * The full implementation of the nodes has been already discussed
-   * in the Tree documentation class.
+   * The nodes of the tree, stored as a structure of arrays indexed by node
+   * ids (i.e., w.r.t. pre-order search). The full implementation has been
+   * already discussed in the Tree documentation class.
+   * values_: the node values (labels), as stored by the storage policy.
+   * parents_: the parent id of each node (the root is its own parent).
+   * child_offsets_: CSR-style offsets; the children ids of node i are
+   * children_[child_offsets_[i]], ..., children_[child_offsets_[i + 1] - 1].
+   * This vector has size() + 1 elements (its last element being
+   * children_.size()), except for the empty tree where it is empty.
+   * children_: the children ids of all nodes, concatenated.
    */
-  Nodes<T> nodes_;
+  NodeValues values_;
+  NodeIds parents_;
+  NodeIds child_offsets_;
+  NodeIds children_;
 
   /**
-   * Perform a breath-first search on the tree,
-   * but return the node ids instead of the node values.
+   * Structural metadata, computed by index_nodes() at the end of every
+   * construction, and computed again after every insertion or removal of a
+   * subtree (which are the only ways to modify a tree).
+   * depths_: the depth of each node (the root has depth 0).
+   * heights_: the depth (=height) of the subtree rooted at each node.
+   * subtree_sizes_: the size of the subtree rooted at each node; thus the
+   * nodes of this subtree have ids id, ..., id + subtree_sizes_[id] - 1.
+   * subtree_leaves_: the number of leaves of the subtree rooted at each
+   * node (so a SubtreeView knows its own in constant time).
+   * last_children_: whether each node is its parent's last child.
+   * leaves_: whether each node is a leaf.
+   * nb_leaves_: the number of leaves of the tree.
    */
-  std::vector<size_t> breadth_first_search_ids() const;
+  NodeIds depths_;
+  NodeIds heights_;
+  NodeIds subtree_sizes_;
+  NodeIds subtree_leaves_;
+  NodeFlags last_children_;
+  NodeFlags leaves_;
+  size_t nb_leaves_ = 0;
+
+  /// Number of children of a node given by its id.
+  size_t arity(size_t id) const;
+
+  /// Id of the k-th child of a node given by its id.
+  size_t child(size_t id, size_t k) const;
+
+  /**
+   * Common part of both bottom-to-top constructors: set up the structure of
+   * a tree made of a new root and the given children, with all node ids
+   * shifted in a single pass. Only the values remain to be appended.
+   */
+  void graft(const std::vector<Tree<T, Storage, Alloc>>& children);
+
+  /**
+   * Compute all the structural metadata above.
+   * As nodes are stored w.r.t. pre-order search, every parent comes before
+   * its children, so one forward pass (for the depths and flags) and one
+   * backward pass (for the subtree sizes) are enough.
+   */
+  void index_nodes();
 
   /**
    * Tell if a node given by its id is a leaf.
@@ -174,27 +390,58 @@ class Tree
    * By convention, the root is its parent's last child.
    * There are as many last children as there are inner nodes.
    */
-  std::vector<bool> last_children() const;
+  const NodeFlags& last_children() const;
 
   /**
    * Return a vector containing the depth for each node
    * (given by its id) in the tree. The root has depth 0.
    */
-  std::vector<size_t> node_depths() const;
+  const NodeIds& node_depths() const;
+
+  /**
+   * Copy the subtree rooted at a given node into a new tree.
+   * The tree must not be empty.
+   */
+  Tree<T, Storage, Alloc> subtree(size_t root) const;
+
+  /**
+   * Implementation of print(), for the subtree rooted at a given node
+   * (which is printed as a root). The tree must not be empty.
+   */
+  template <typename Sink, typename Companion>
+    void print_subtree(Sink& sink, size_t root, const Companion& pc) const;
 
   /**
-   * Perform a post-order search on the tree,
-   * but return the node ids instead of the node values.
+   * Implementation of tree mapping: fill an empty tree (of the same shape)
+   * with the mapped values, serially or in parallel. Shared with
+   * BinaryTree<T>::map() and BinaryTree<T>::map_parallel().
+   * copy_shape_to() copies the structure of the tree (without the values).
    */
-  std::vector<size_t> post_order_search_ids() const;
+  template <typename U>
+    void map_to(Tree<U, Storage, RebindAlloc<Alloc, U>>& tree, \
+        const std::function<U(T)>& f) const;
+  template <typename U, typename F>
+    void map_parallel_to(Tree<U, Storage, RebindAlloc<Alloc, U>>& tree, \
+        F& f, ThreadPool& pool) const;
+  template <typename U>
+    void copy_shape_to(Tree<U, Storage, RebindAlloc<Alloc, U>>& tree) const;
+
+  /**
+   * Implementation of subtree reductions: compute the aggregate of a node
+   * given by its id, whose children's aggregates are already computed.
+   */
+  template <typename R, typename Init, typename Combine>
+    void reduce_node(size_t id, std::vector<R>& out, Init& init, \
+        Combine& combine) const;
 };
 
 /**
  * Overload the << operator for pretty-printing. This calls
- * Tree<T>::to_string() without parameter (i.e., use the default
+ * Tree<T>::print() with the stream as a sink (i.e., use the default
  * TreePrintCompanion).
  */
-template <typename T>
-std::ostream& operator<<(std::ostream& os, const Tree<T>& tree);
+template <typename T, typename Storage, typename Alloc>
+std::ostream& operator<<(std::ostream& os, \
+    const Tree<T, Storage, Alloc>& tree);
 
 #include "tree.hxx" /* template class implementation */
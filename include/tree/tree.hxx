@@ -2,316 +2,598 @@
 
 #include "tree.hh" /* template class interface */
 
-#include <algorithm> // std::reverse
-#include <queue>
-#include <stack>
+#include <algorithm> // std::fill, std::move, std::sort
+#include <iterator> // std::back_inserter
+#include <type_traits> // std::is_same
 
+#include "symbol_index.hh"
 #include "tree_error.hh"
 
-  template <typename T>
-Tree<T>::Tree(const T& root, const std::vector<Tree<T>>& children)
-  // parent's root is itself and has id == 0
-  : nodes_{{std::make_shared<T>(root), {0, 0}}}
+template <typename T, typename Storage, typename Alloc>
+Tree<T, Storage, Alloc>::Tree(const T& root, \
+    const std::vector<Tree<T, Storage, Alloc>>& children, const Alloc& alloc)
+  : Tree(Table<T>(), alloc)
 {
-  size_t offset = 1; // counter used for updating all node ids
-  for (auto child : children)
-  {
-    nodes_[0].second.push_back(offset); // child is a new root's child
-
-    for (auto& node : child.nodes_)
-    {
-
-      for (auto& id : node.second)
-        id += offset; // update id's grandchildren for all child's nodes
-    }
-
-    child.nodes_[0].second[0] = 0; // root is child's parent
-
-    /* Add the whole child tree structure to root. */
-#if 0
-    // Other possible implementation ...
-    std::copy (child.nodes_.begin(), child.nodes_.end(), \
-        std::back_inserter(nodes_));
-#endif
-    nodes_.insert(nodes_.end(), child.nodes_.begin(), child.nodes_.end());
+  graft(children);
+  values_.push_back(Values::make(root, alloc));
+  for (const auto& child : children)
+    values_.insert(values_.end(), child.values_.begin(), child.values_.end());
+  index_nodes();
+}
 
-    /* Update offset for the next child. */
-    offset += child.size();
+template <typename T, typename Storage, typename Alloc>
+Tree<T, Storage, Alloc>::Tree(T root, \
+    std::vector<Tree<T, Storage, Alloc>>&& children, const Alloc& alloc)
+  : Tree(Table<T>(), alloc)
+{
+  graft(children);
+  values_.push_back(Values::make(std::move(root), alloc));
+  for (auto& child : children)
+  {
+    /* Steal the values: no reference count is updated. */
+    std::move(child.values_.begin(), child.values_.end(), \
+        std::back_inserter(values_));
+    child.values_.clear();
   }
+  index_nodes();
 }
 
-  template <typename T>
-Tree<T>::Tree(const Table<T>& table)
+template <typename T, typename Storage, typename Alloc>
+Tree<T, Storage, Alloc>::Tree(const Table<T>& table, const Alloc& alloc)
+  : values_(alloc), parents_(alloc), child_offsets_(alloc), \
+    children_(alloc), depths_(alloc), heights_(alloc), \
+    subtree_sizes_(alloc), subtree_leaves_(alloc), last_children_(alloc), \
+    leaves_(alloc)
 {
   size_t n = table.size();
   if (n > 0)
   {
     /* Store all different values in an array, for lookup purposes. */
-    std::vector<Ptr<T>> symbols;
+    std::vector<Ptr<T>> keys;
+    keys.reserve(n);
     for (size_t i = 0; i < n; i++)
-      symbols.push_back(table[i].first);
+      keys.push_back(table[i].first);
+    SymbolIndex<T> symbols(keys);
+
+    values_.reserve(n);
+    for (const auto& key : keys)
+      values_.push_back(Values::adopt(key));
+    parents_.assign(n, 0); // parent ids are not correct yet
+    child_offsets_.push_back(0);
 
     /* Construct every node. */
     for (size_t i = 0; i < n; i++)
     {
-      /* Add to the node its value and own id. */
-      nodes_.push_back({symbols[i], {0, i}}); // parent id is not correct yet
-
       /* Add to the node the children ids. */
       for (const auto& symbol : table[i].second)
       {
         /* Find the id corresponding to each child. */
-        size_t j = 0;
-        while (j < n and not (*symbols[j] == *symbol))
-          j++;
+        size_t j = symbols.find(symbol);
         if (j == n) // Symbol not found
         {
-          nodes_.clear(); // Leave an empty tree as a zombie
+          /* Leave an empty tree as a zombie. */
+          values_.clear();
+          parents_.clear();
+          child_offsets_.clear();
+          children_.clear();
           throw TreeException::InvalidTable(
               "[ERROR] Calling Tree<T>::Tree(const Table<T>&) failed: "
               "Invalid table.\nConstructing an empty tree instead.");
         }
 
         /* Add the child id to the node data. */
-        nodes_[i].second.push_back(j);
+        children_.push_back(j);
       }
+      child_offsets_.push_back(children_.size());
     }
 
     /* Fix all parent ids, as for now they are set to 0. */
     for (size_t i = 1; i < n; i++)
-      for (size_t j = 2; j < nodes_[i].second.size(); j++)
-      {
-        /* nodes_[i].second[j] is j-th child of i */
-        nodes_[nodes_[i].second[j]].second[0] = i;
-      }
+      for (size_t k = 0; k < arity(i); k++)
+        parents_[child(i, k)] = i;
+
+    index_nodes();
   }
 }
 
-template <typename T>
-std::vector<Ptr<T>> Tree<T>::breadth_first_search() const
+template <typename T, typename Storage, typename Alloc>
+template <typename S>
+Tree<T, Storage, Alloc>::Tree(const Tree<T, S, Alloc>& tree)
+  : Tree(Table<T>(), tree.get_allocator())
+{
+  Alloc alloc = get_allocator();
+  values_.reserve(tree.size());
+  for (size_t i = 0; i < tree.size(); i++)
+    values_.push_back(Values::make(tree.value(i), alloc));
+  parents_ = tree.parents_;
+  child_offsets_ = tree.child_offsets_;
+  children_ = tree.children_;
+  depths_ = tree.depths_;
+  heights_ = tree.heights_;
+  subtree_sizes_ = tree.subtree_sizes_;
+  subtree_leaves_ = tree.subtree_leaves_;
+  last_children_ = tree.last_children_;
+  leaves_ = tree.leaves_;
+  nb_leaves_ = tree.nb_leaves_;
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::arity(size_t id) const
+{
+  return child_offsets_[id + 1] - child_offsets_[id];
+}
+
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> Tree<T, Storage, Alloc>::breadth_first_search() const
 {
-  std::vector<size_t> sorted_ids = breadth_first_search_ids();
   std::vector<Ptr<T>> out;
-  for (const auto& id : sorted_ids)
-    out.push_back(nodes_[id].first);
+  out.reserve(size());
+  auto range = breadth_first();
+  for (auto it = range.begin(); it != range.end(); ++it)
+    out.push_back(Values::share(values_[it.id()]));
   return out;
 }
 
-template <typename T>
-std::vector<size_t> Tree<T>::breadth_first_search_ids() const
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, BreadthFirstOrder, Storage, Alloc>
+Tree<T, Storage, Alloc>::breadth_first() const
+{
+  return {*this};
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::child(size_t id, size_t k) const
+{
+  return children_[child_offsets_[id] + k];
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename U>
+void Tree<T, Storage, Alloc>::copy_shape_to( \
+    Tree<U, Storage, RebindAlloc<Alloc, U>>& tree) const
+{
+  tree.parents_ = parents_;
+  tree.child_offsets_ = child_offsets_;
+  tree.children_ = children_;
+  tree.depths_ = depths_;
+  tree.heights_ = heights_;
+  tree.subtree_sizes_ = subtree_sizes_;
+  tree.subtree_leaves_ = subtree_leaves_;
+  tree.last_children_ = last_children_;
+  tree.leaves_ = leaves_;
+  tree.nb_leaves_ = nb_leaves_;
+}
+
+template <typename T, typename Storage, typename Alloc>
+ssize_t Tree<T, Storage, Alloc>::depth() const
 {
-  /*
-   * We make the search in an iterative way, using a queue.
-   * Although it is much more natural to use recursion here, this would
-   * probably require, due to our implementation, to get at each step the
-   * children as a collection of *newly made Tree* in order to apply the
-   * recursion on them, which is far too expensive.
-   */
   if (size() == 0)
-    return {};
+    return -1;
+  return static_cast<ssize_t>(heights_[0]);
+}
+
+template <typename T, typename Storage, typename Alloc>
+Alloc Tree<T, Storage, Alloc>::get_allocator() const
+{
+  return Alloc(values_.get_allocator());
+}
+
+template <typename T, typename Storage, typename Alloc>
+void Tree<T, Storage, Alloc>::graft( \
+    const std::vector<Tree<T, Storage, Alloc>>& children)
+{
+  /* Reserve the whole storage at once. */
+  size_t n = 1;
+  for (const auto& child : children)
+    n += child.size();
+  values_.reserve(n);
+  parents_.reserve(n);
+  child_offsets_.reserve(n + 1);
+  children_.reserve(n - 1);
+
+  /* The root's parent is itself and has id == 0. */
+  parents_.push_back(0);
+  child_offsets_.push_back(0);
+  child_offsets_.push_back(children.size());
+
+  /* The root's children ids come first. */
+  size_t offset = 1; // counter used for updating all node ids
+  for (const auto& child : children)
+  {
+    children_.push_back(offset); // child is a new root's child
+    offset += child.size();
+  }
 
-  std::queue<size_t> queue;
-  std::vector<size_t> out;
+  offset = 1;
+  for (const auto& child : children)
+  {
+    /* Add the whole child tree structure to root. */
+    parents_.push_back(0); // root is child's parent
+    for (size_t i = 1; i < child.size(); i++)
+      parents_.push_back(child.parents_[i] + offset);
+
+    /*
+     * The last element of child_offsets_ is already the offset of the
+     * child's root, so we only append the offsets of the other child's nodes
+     * (and the new last element).
+     */
+    size_t base = children_.size();
+    for (size_t i = 1; i < child.child_offsets_.size(); i++)
+      child_offsets_.push_back(child.child_offsets_[i] + base);
+    for (const auto& id : child.children_)
+      children_.push_back(id + offset); // update id's grandchildren
 
-  /* Enqueue root's id. */
-  size_t id = 0;
-  queue.push(id);
+    /* Update offset for the next child. */
+    offset += child.size();
+  }
+}
 
-  while (!queue.empty())
+template <typename T, typename Storage, typename Alloc>
+void Tree<T, Storage, Alloc>::index_nodes()
+{
+  size_t n = size();
+  depths_.assign(n, 0);
+  heights_.assign(n, 0);
+  subtree_sizes_.assign(n, 1);
+  subtree_leaves_.assign(n, 0);
+  last_children_.assign(n, false);
+  leaves_.assign(n, false);
+  nb_leaves_ = 0;
+  if (n == 0)
+    return;
+
+  /* Forward pass: parents are visited before their children. */
+  last_children_[0] = true;
+  for (size_t i = 0; i < n; i++)
   {
-    /* Pop one node id from the queue, and add it to the output. */
-    id = queue.front();
-    queue.pop();
-    out.push_back(id);
-
-    /* Add the children ids to the queue. */
-    const auto& v = nodes_[id].second;
-    for (size_t i = 2; i < v.size(); i++)
-      queue.push(v[i]);
+    if (i > 0)
+      depths_[i] = depths_[parents_[i]] + 1;
+
+    if (arity(i) == 0)
+    {
+      leaves_[i] = true;
+      subtree_leaves_[i] = 1;
+      nb_leaves_++;
+    }
+    else
+      last_children_[child(i, arity(i) - 1)] = true;
   }
 
-  return out;
+  /* Backward pass: children are visited before their parents. */
+  for (size_t i = n - 1; i > 0; i--)
+  {
+    subtree_sizes_[parents_[i]] += subtree_sizes_[i];
+    subtree_leaves_[parents_[i]] += subtree_leaves_[i];
+    if (heights_[i] + 1 > heights_[parents_[i]])
+      heights_[parents_[i]] = heights_[i] + 1;
+  }
 }
 
-template <typename T>
-ssize_t Tree<T>::depth() const
+template <typename T, typename Storage, typename Alloc>
+void Tree<T, Storage, Alloc>::insert_subtree(size_t parent, size_t k, \
+    const Tree<T, Storage, Alloc>& subtree)
 {
-  if (size() == 0)
-    return -1;
+  if (parent >= size() or k > arity(parent))
+    throw TreeException::NoSuchNode("[ERROR]" \
+        " Calling Tree<T>::insert_subtree() failed: No such node\n");
+  if (&subtree == this) // its arrays are modified while being read
+  {
+    const Tree<T, Storage, Alloc> copy(subtree);
+    insert_subtree(parent, k, copy);
+    return;
+  }
+  size_t n = size();
+  size_t m = subtree.size();
+  if (m == 0)
+    return;
 
-  /* Return the max of all node depths. */
-  size_t depth = 0;
-  for (size_t i = 0; i < size(); i++)
-    if (node_depths()[i] > depth)
-      depth = node_depths()[i];
-  return static_cast<ssize_t>(depth);
+  /*
+   * The subtree takes the ids [pos, pos + m): those of the k-th child of the
+   * parent, or right after the subtree of the parent if k is its arity.
+   * The next nodes are shifted by m.
+   */
+  size_t pos = (k < arity(parent)) ? child(parent, k) \
+    : parent + subtree_sizes_[parent];
+  auto shift = [pos, m](size_t id) { return (id < pos) ? id : id + m; };
+
+  values_.insert(values_.begin() + pos, subtree.values_.begin(), \
+      subtree.values_.end());
+
+  /* Renumber the parents and the children, in the new order of the nodes. */
+  NodeIds parents(n + m, 0, get_allocator());
+  NodeIds child_offsets(get_allocator());
+  NodeIds children(get_allocator());
+  child_offsets.reserve(n + m + 1);
+  children.reserve(children_.size() + subtree.children_.size() + 1);
+  child_offsets.push_back(0);
+  for (size_t i = 0; i < pos; i++) // old nodes before the subtree
+  {
+    parents[i] = parents_[i];
+    for (size_t c = 0; c < arity(i); c++)
+    {
+      if (i == parent and c == k)
+        children.push_back(pos);
+      children.push_back(shift(child(i, c)));
+    }
+    if (i == parent and k == arity(i))
+      children.push_back(pos);
+    child_offsets.push_back(children.size());
+  }
+  for (size_t j = 0; j < m; j++) // nodes of the subtree
+  {
+    parents[pos + j] = (j == 0) ? parent : pos + subtree.parents_[j];
+    for (size_t c = 0; c < subtree.arity(j); c++)
+      children.push_back(pos + subtree.child(j, c));
+    child_offsets.push_back(children.size());
+  }
+  for (size_t i = pos; i < n; i++) // old nodes after the subtree
+  {
+    parents[i + m] = shift(parents_[i]);
+    for (size_t c = 0; c < arity(i); c++)
+      children.push_back(shift(child(i, c)));
+    child_offsets.push_back(children.size());
+  }
+
+  parents_ = std::move(parents);
+  child_offsets_ = std::move(child_offsets);
+  children_ = std::move(children);
+  index_nodes();
 }
 
-template <typename T>
-bool Tree<T>::is_leaf(size_t id) const
+template <typename T, typename Storage, typename Alloc>
+bool Tree<T, Storage, Alloc>::is_leaf(size_t id) const
 {
-  return id < size() and nodes_[id].second.size() <= 2;
+  return id < size() and leaves_[id];
 }
 
-template <typename T>
-std::vector<bool> Tree<T>::last_children() const
+template <typename T, typename Storage, typename Alloc>
+const typename Tree<T, Storage, Alloc>::NodeFlags&
+Tree<T, Storage, Alloc>::last_children() const
 {
-  if (size() == 0)
-    return {};
+  return last_children_;
+}
 
-  std::vector<bool> out(size(), false);
-  out[0] = true;
-  for (size_t i = 0; i < size(); i++)
-    if (!is_leaf(i))
-    {
-      size_t j = nodes_[i].second.back(); // nodes_[i]'s last child id
-      out[j] = true;
-    }
-  return out;
+template <typename T, typename Storage, typename Alloc>
+template <typename U>
+Tree<U, Storage, RebindAlloc<Alloc, U>>
+Tree<T, Storage, Alloc>::map(std::function<U(T)> f) const
+{
+  RebindAlloc<Alloc, U> alloc = get_allocator();
+  Tree<U, Storage, RebindAlloc<Alloc, U>> tree(Table<U>(), alloc);
+  map_to(tree, f);
+  return tree;
 }
 
-template <typename T>
+template <typename T, typename Storage, typename Alloc>
 template <typename U>
-Tree<U> Tree<T>::map(std::function<U(T)> f) const
+void Tree<T, Storage, Alloc>::map_to( \
+    Tree<U, Storage, RebindAlloc<Alloc, U>>& tree, \
+    const std::function<U(T)>& f) const
 {
-  Tree<U> tree;
-  for (const auto& node : nodes_)
-    tree.Tree<U>::nodes_.push_back(\
-        {std::make_shared<U>(f(*node.first)), node.second});
+  /* Only the values change: the structure is copied as is. */
+  auto alloc = tree.get_allocator();
+  tree.values_.reserve(size());
+  for (const auto& value : values_)
+  {
+    U mapped = f(Values::get(value));
+    tree.values_.push_back( \
+        ValueStorage<U, Storage>::make(std::move(mapped), alloc));
+  }
+  copy_shape_to(tree);
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename U, typename F>
+Tree<U, Storage, RebindAlloc<Alloc, U>>
+Tree<T, Storage, Alloc>::map_parallel(F f, ThreadPool& pool) const
+{
+  RebindAlloc<Alloc, U> alloc = get_allocator();
+  Tree<U, Storage, RebindAlloc<Alloc, U>> tree(Table<U>(), alloc);
+  map_parallel_to(tree, f, pool);
   return tree;
 }
 
-template <typename T>
-size_t Tree<T>::nb_inner_nodes() const
+template <typename T, typename Storage, typename Alloc>
+template <typename U, typename F>
+void Tree<T, Storage, Alloc>::map_parallel_to( \
+    Tree<U, Storage, RebindAlloc<Alloc, U>>& tree, F& f, \
+    ThreadPool& pool) const
+{
+  /*
+   * The output is sized beforehand, so that every thread writes its own
+   * range of values. A few ranges per thread balance the load, while
+   * keeping the ranges large enough for the scheduling cost to vanish.
+   */
+  auto alloc = tree.get_allocator();
+  size_t n = size();
+  size_t grain = std::max<size_t>(1024, n / (4 * pool.nb_threads()));
+  tree.values_.resize(n);
+  pool.parallel_for(n, grain, [&](size_t begin, size_t end)
+  {
+    for (size_t i = begin; i < end; i++)
+      tree.values_[i] = ValueStorage<U, Storage>::make( \
+          f(Values::get(values_[i])), alloc);
+  });
+  copy_shape_to(tree);
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::nb_inner_nodes() const
 {
   return size() - nb_leaves();
 }
 
-template <typename T>
-size_t Tree<T>::nb_leaves() const
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::nb_leaves() const
 {
-  size_t count = 0;
-  for (size_t i = 0; i < size(); i++)
-    if (is_leaf(i))
-      count++;
-  return count;
+  return nb_leaves_;
 }
 
-template <typename T>
-std::vector<size_t> Tree<T>::node_depths() const
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::node_depth(size_t id) const
 {
-  /**
-   * To compute the depth of a node, we just we follow the path from this node
-   * up to the root, and compute the length of this path.
-   */
-  std::vector<size_t> out;
+  return depths_[id];
+}
 
-  for (size_t i = 0; i < size(); i++)
-  {
-    size_t depth = 0;
-    for (size_t j = i; j != 0; j = nodes_[j].second[0])
-      depth++;
-    out.push_back(depth);
-  }
+template <typename T, typename Storage, typename Alloc>
+const typename Tree<T, Storage, Alloc>::NodeIds&
+Tree<T, Storage, Alloc>::node_depths() const
+{
+  return depths_;
+}
 
-  return out;
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::parent(size_t id) const
+{
+  return parents_[id];
+}
+
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, PostOrder, Storage, Alloc>
+Tree<T, Storage, Alloc>::post_order() const
+{
+  return {*this};
+}
+
+template <typename T, typename Storage, typename Alloc>
+TreeRange<T, PreOrder, Storage, Alloc>
+Tree<T, Storage, Alloc>::pre_order() const
+{
+  return {*this};
 }
 
-template <typename T>
-std::vector<Ptr<T>> Tree<T>::pre_order_search() const
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> Tree<T, Storage, Alloc>::pre_order_search() const
 {
   /*
    * Recall that our implementation is such that all nodes are already stored
    * w.r.t. pre-order search, so we only have to fetch their labels (values).
    */
   std::vector<Ptr<T>> out;
-  for (const auto& node : nodes_)
-    out.push_back(node.first);
+  out.reserve(size());
+  for (const auto& value : values_)
+    out.push_back(Values::share(value));
   return out;
 }
 
-template <typename T>
-std::vector<Ptr<T>> Tree<T>::post_order_search() const
+template <typename T, typename Storage, typename Alloc>
+std::vector<Ptr<T>> Tree<T, Storage, Alloc>::post_order_search() const
 {
-  std::vector<size_t> sorted_ids = post_order_search_ids();
   std::vector<Ptr<T>> out;
-  for (const auto& id : sorted_ids)
-    out.push_back(nodes_[id].first);
+  out.reserve(size());
+  auto range = post_order();
+  for (auto it = range.begin(); it != range.end(); ++it)
+    out.push_back(Values::share(values_[it.id()]));
   return out;
 }
 
-template <typename T>
-std::vector<size_t> Tree<T>::post_order_search_ids() const
+template <typename T, typename Storage, typename Alloc>
+void Tree<T, Storage, Alloc>::remove_subtree(size_t id)
 {
-  /*
-   * We make the search in an iterative way, using a stack.
-   * Although it is much more natural to use recursion here, this would
-   * probably require, due to our implementation, to get at each step the
-   * children as a collection of *newly made Tree* in order to apply the
-   * recursion on them, which is far too expensive.
-   */
-  if (size() == 0)
-    return {};
+  remove_subtrees({id});
+}
 
-  std::stack<size_t> stack;
-  std::vector<size_t> out;
+template <typename T, typename Storage, typename Alloc>
+void Tree<T, Storage, Alloc>::remove_subtrees(Ids ids)
+{
+  size_t n = size();
+  for (size_t id : ids)
+    if (id >= n)
+      throw TreeException::NoSuchNode("[ERROR]" \
+          " Calling Tree<T>::remove_subtrees() failed: No such node\n");
 
-  /* Push root's id onto the stack. */
-  size_t id = 0;
-  stack.push(id);
+  /*
+   * Mark the removed nodes. The ids are sorted, so that a subtree nested in
+   * another one is already marked, and every node is marked at most once.
+   */
+  std::sort(ids.begin(), ids.end());
+  std::vector<bool> removed(n, false);
+  for (size_t id : ids)
+    if (!removed[id])
+      std::fill(removed.begin() + id, \
+          removed.begin() + id + subtree_sizes_[id], true);
+
+  /* The new id of a kept node is the number of kept nodes before it. */
+  Ids new_ids(n);
+  size_t kept = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    new_ids[i] = kept;
+    if (!removed[i])
+    {
+      if (kept < i)
+        values_[kept] = std::move(values_[i]);
+      kept++;
+    }
+  }
+  values_.erase(values_.begin() + kept, values_.end());
 
-  while (!stack.empty())
+  /* Renumber the parents and the children, in the new order of the nodes. */
+  NodeIds parents(get_allocator());
+  NodeIds child_offsets(get_allocator());
+  NodeIds children(get_allocator());
+  if (kept > 0) // otherwise, the root is removed, and the tree is empty
   {
-    /* Pop one node id from the stack, and add it to the output. */
-    id = stack.top();
-    stack.pop();
-    out.push_back(id);
-
-    /* Add the children ids to the stack. */
-    const auto& v = nodes_[id].second;
-    for (size_t i = 2; i < v.size(); i++)
-      stack.push(v[i]);
+    parents.reserve(kept);
+    child_offsets.reserve(kept + 1);
+    children.reserve(kept - 1);
+    child_offsets.push_back(0);
+    for (size_t i = 0; i < n; i++)
+    {
+      if (removed[i])
+        continue;
+      parents.push_back(new_ids[parents_[i]]);
+      for (size_t c = 0; c < arity(i); c++)
+        if (!removed[child(i, c)])
+          children.push_back(new_ids[child(i, c)]);
+      child_offsets.push_back(children.size());
+    }
   }
 
-  /* Reverse the output vector, so the root comes last. */
-  std::reverse(out.begin(), out.end());
-  return out;
+  parents_ = std::move(parents);
+  child_offsets_ = std::move(child_offsets);
+  children_ = std::move(children);
+  index_nodes();
 }
 
-template <typename T>
-std::string Tree<T>::represent(const TreePrintCompanion<T>& pc) const
+template <typename T, typename Storage, typename Alloc>
+template <typename Companion>
+std::string Tree<T, Storage, Alloc>::represent(const Companion& pc) const
 {
   std::string s;
-  for (const auto& node : nodes_)
+  for (size_t i = 0; i < size(); i++)
   {
-    s += "Node #" + std::to_string(node.second[1]);
+    s += "Node #" + std::to_string(i);
     s += ": value: ";
-    const T& t = *node.first;
-    if (node.second[1] == 0) // node.second[1]: node's id; 0 = root's id
-      s += pc.print_root()(t);
-    else if (is_leaf(node.second[1]))
-      s += pc.print_leaf()(t);
+    const T& t = value(i);
+    if (i == 0) // 0 = root's id
+      append_label(s, pc.print_root(), t);
+    else if (is_leaf(i))
+      append_label(s, pc.print_leaf(), t);
     else
-      s += pc.print_node()(t);
-    s += " | ids: [";
-    for (const auto& id : node.second)
-      s += std::to_string(id) + ", ";
+      append_label(s, pc.print_node(), t);
+    /* List the parent id, the node's own id, and then its children ids. */
+    s += " | ids: [" + std::to_string(parents_[i]) + ", ";
+    s += std::to_string(i) + ", ";
+    for (size_t k = 0; k < arity(i); k++)
+      s += std::to_string(child(i, k)) + ", ";
     s += "\b\b]\n";
   }
   return s;
 }
 
-template <typename T>
-size_t Tree<T>::root_arity() const
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::root_arity() const
 {
   if (size() == 0)
     throw TreeException::EmptyTree("[ERROR]" \
         " Calling Tree<T>::root_arity() failed: Empty tree\n");
-  return nodes_[0].second.size() - 2;
+  return arity(0);
 }
 
-template <typename T>
-std::vector<Tree<T>> Tree<T>::root_children() const
+template <typename T, typename Storage, typename Alloc>
+std::vector<Tree<T, Storage, Alloc>>
+Tree<T, Storage, Alloc>::root_children() const
 {
   if (size() == 0)
     throw TreeException::EmptyTree("[ERROR]" \
@@ -320,79 +602,175 @@ std::vector<Tree<T>> Tree<T>::root_children() const
   if (root_arity() == 0)
     return {};
 
-  /* Get root's children ids, and add size() at the end for convenience. */
-  std::vector<size_t> children_ids;
-  for (size_t i = 2; i < nodes_[0].second.size(); i++)
-    children_ids.push_back(nodes_[0].second[i]);
-  children_ids.push_back(size());
+  std::vector<Tree<T, Storage, Alloc>> out;
+  out.reserve(root_arity());
+  for (size_t k = 0; k < root_arity(); k++)
+    out.push_back(subtree(child(0, k)));
+  return out;
+}
 
-  /* Initialize the output vector. */
-  std::vector<Tree<T>> out((children_ids.size() - 1), Tree<T>{});
+template <typename T, typename Storage, typename Alloc>
+template <typename R, typename Init, typename Combine>
+void Tree<T, Storage, Alloc>::reduce_node(size_t id, std::vector<R>& out, \
+    Init& init, Combine& combine) const
+{
+  R aggregate = init(Values::get(values_[id]));
+  for (size_t k = 0; k < arity(id); k++)
+    combine(aggregate, out[child(id, k)]);
+  out[id] = std::move(aggregate);
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename R, typename Init, typename Combine>
+std::vector<R> Tree<T, Storage, Alloc>::reduce_subtrees(Init init, \
+    Combine combine) const
+{
+  std::vector<R> out(size());
+  for (size_t id = size(); id-- > 0;)
+    reduce_node(id, out, init, combine);
+  return out;
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename R, typename Init, typename Combine>
+std::vector<R> Tree<T, Storage, Alloc>::reduce_subtrees_parallel(Init init, \
+    Combine combine, ThreadPool& pool) const
+{
+  static_assert(!std::is_same<R, bool>::value, \
+      "Tree<T>::reduce_subtrees_parallel() cannot return bools");
 
   /*
-   * Update all ids in children trees.
-   * Recall that all nodes in the given tree are stored w.r.t. pre-order
-   * search; in other words, their indexes for a same given child tree form a
-   * sequence of consecutive integers; index 0 corresponds to the current root
-   * and has to be dropped, then child #0's sequence comes first, then
-   * child #1's, and so on. So, thanks to children_ids constructed above, the
-   * nodes for every child are retrieved easily, whence the double loop
-   * below.
-   * Actually, the tedious part of the job consists in updating correctly
-   * all node ids (references) inside all children trees. If 'offset' is the
-   * integer in the given tree indexing a new root, then we have to substract
-   * this offset to all the ids inside the corresponding child tree,
-   * but this new root must have its vector ids starting with 0,0, because
-   * it does become a new root and thus its own parent.
+   * Split the tree, w.r.t. pre-order search: a node whose subtree is small
+   * enough is the root of an independent subtree (a range of consecutive
+   * ids), which the search skips; any other node is a top node, reduced
+   * once all the tasks are done. Independent subtrees are batched into
+   * tasks of about grain nodes, so that deep trees with many small side
+   * subtrees do not yield as many tiny tasks. As tasks only write the
+   * aggregates of their own subtrees, they never conflict.
    */
-  for (size_t j = 0; j < out.size(); j++)
-    // By construction, children_ids[j + 1] == size() if j == out.size() -1
-    for (size_t i = children_ids[j]; i < children_ids[j + 1]; i++)
+  size_t n = size();
+  size_t grain = std::max<size_t>(1024, n / (8 * pool.nb_threads()));
+  if (n <= grain)
+    return reduce_subtrees<R>(init, combine);
+
+  std::vector<R> out(n);
+  Ids tops;
+  Ids roots; // roots of the independent subtrees of the next task
+  size_t batch_size = 0;
+  ThreadPool::TaskGroup group; // so that the pool may be shared
+  auto submit_batch = [&]()
+  {
+    pool.submit([this, roots, &out, &init, &combine]()
     {
-      Node<T> child_node = nodes_[i];
-      size_t offset = children_ids[j];
-      for (auto& child_id : child_node.second)
-        child_id -= offset; // substract offset to all ids in the child
-      if (i == children_ids[j])
-        child_node.second[0] = 0; // let the child root ids start with 0,0
-      out[j].nodes_.push_back(child_node); // commit the updates in the result
+      for (auto root : roots)
+        for (size_t i = root + subtree_sizes_[root]; i-- > root;)
+          reduce_node(i, out, init, combine);
+    }, group);
+    roots.clear();
+    batch_size = 0;
+  };
+
+  for (size_t id = 0; id < n;)
+  {
+    if (subtree_sizes_[id] > grain)
+    {
+      tops.push_back(id);
+      id++;
+      continue;
     }
+    roots.push_back(id);
+    batch_size += subtree_sizes_[id];
+    id += subtree_sizes_[id];
+    if (batch_size >= grain)
+      submit_batch();
+  }
+  if (!roots.empty())
+    submit_batch();
+  pool.wait(group);
 
+  /* The children of the top nodes are reduced, either by tasks or below. */
+  for (size_t k = tops.size(); k-- > 0;)
+    reduce_node(tops[k], out, init, combine);
   return out;
 }
 
-template <typename T>
-Ptr<T> Tree<T>::root_value() const
+template <typename T, typename Storage, typename Alloc>
+Ptr<T> Tree<T, Storage, Alloc>::root_value() const
 {
   if (size() == 0)
     throw TreeException::EmptyTree("[ERROR]" \
         " Calling Tree<T>::root_value() failed: Empty tree\n");
-  return nodes_[0].first;
+  return Values::share(values_[0]);
 }
 
-template <typename T>
-size_t Tree<T>::size() const
+template <typename T, typename Storage, typename Alloc>
+size_t Tree<T, Storage, Alloc>::size() const
 {
-  return nodes_.size();
+  return values_.size();
 }
 
-template <typename T>
-std::string Tree<T>::to_string(const TreePrintCompanion<T>& pc) const
+template <typename T, typename Storage, typename Alloc>
+Tree<T, Storage, Alloc> Tree<T, Storage, Alloc>::subtree(size_t root) const
 {
-  if (size() == 0)
-    return {};
-
-  std::string s;
-  auto depths = node_depths();
   /*
-   * Vector flags for the columns: we shall print
-   * "|" if the flag is true, and " " otherwise
+   * Recall that all nodes in the given tree are stored w.r.t. pre-order
+   * search; in other words, the ids of the nodes of a same subtree form a
+   * sequence of consecutive integers, which starts with the subtree's root.
+   * Thanks to the subtree sizes, the nodes of the subtree are retrieved
+   * easily, as slices of all the arrays storing the tree.
+   * Actually, the tedious part of the job consists in updating correctly
+   * all node ids (references) inside the subtree. If 'offset' is the
+   * integer in the given tree indexing the new root, then we have to
+   * substract this offset to all the ids inside the subtree, but this new
+   * root must have parent id 0, because it does become a new root and thus
+   * its own parent.
    */
-  std::vector<bool> printable_columns(depth() + 1, false);
+  size_t offset = root;
+  size_t end = offset + subtree_sizes_[offset];
+  Tree<T, Storage, Alloc> tree(Table<T>(), get_allocator());
+
+  tree.values_.assign(values_.begin() + offset, values_.begin() + end);
+
+  tree.parents_.reserve(end - offset);
+  tree.parents_.push_back(0); // let the subtree root be its own parent
+  for (size_t i = offset + 1; i < end; i++)
+    tree.parents_.push_back(parents_[i] - offset);
+
+  size_t base = child_offsets_[offset];
+  tree.child_offsets_.reserve(end - offset + 1);
+  for (size_t i = offset; i <= end; i++)
+    tree.child_offsets_.push_back(child_offsets_[i] - base);
+
+  tree.children_.reserve(end - offset - 1);
+  for (size_t c = child_offsets_[offset]; c < child_offsets_[end]; c++)
+    tree.children_.push_back(children_[c] - offset);
+
+  tree.index_nodes();
+  return tree;
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename Sink, typename Companion>
+void Tree<T, Storage, Alloc>::print(Sink& sink, const Companion& pc) const
+{
+  if (size() > 0)
+    print_subtree(sink, 0, pc);
+}
+
+template <typename T, typename Storage, typename Alloc>
+template <typename Sink, typename Companion>
+void Tree<T, Storage, Alloc>::print_subtree(Sink& sink, size_t root, \
+    const Companion& pc) const
+{
+  const auto& depths = node_depths();
+  size_t base = depths[root]; // depths are taken relatively to the root
+  size_t end = root + subtree_sizes_[root];
 
   /* Print the root. */
-  s += pc.print_root()(*nodes_[0].first) + "\n";
-  printable_columns[0] = true;
+  std::string line;
+  append_label(line, pc.print_root(), value(root));
+  line += '\n';
+  sink.write(line.data(), line.size());
 
   /* Give self-explicit names for all characters and Unicode strings used. */
   int dashes = pc.dashes();
@@ -405,43 +783,70 @@ std::string Tree<T>::to_string(const TreePrintCompanion<T>& pc) const
   std::string hook = "\u2514"; // └
   std::string tee = "\u251c"; // ├
 
+  /* Precompute the pieces of every line, so no temporary string is made. */
+  auto hook_tail = hook + hline + spaces;
+  auto tee_tail = tee + hline + spaces;
+  auto vline_column = vline + tab;
+  auto blank_column = " " + tab;
+
+  /*
+   * The prefix of every line consists in one column per ancestor (but the
+   * root): we print "|" if this ancestor has a next sibling, and " "
+   * otherwise. As nodes are printed w.r.t. pre-order search, this prefix is
+   * updated incrementally: prefix_sizes[d] is the size of the prefix for the
+   * children of the last printed node with depth d.
+   */
+  std::string prefix;
+  std::vector<size_t> prefix_sizes(heights_[root] + 1, 0);
+
   /* Print the other nodes. */
-  auto lc = last_children();
-  for (size_t i = 1; i < size(); i++)
+  const auto& lc = last_children();
+  for (size_t i = root + 1; i < end; i++)
   {
     /* Print the vertical lines and the horizontal lines/spaces. */
-    size_t j = 0;
-    if (depths[i] > 1)
-      for (; j < depths[i] - 1; j++)
-        s += (printable_columns[j] ? vline : " ") + tab;
+    size_t depth = depths[i] - base;
+    prefix.resize(prefix_sizes[depth - 1]);
+    line = prefix;
 
-    /* Print the tees and the hooks. */
-    if (lc[i]) // lc = last_children()
-    {
-      s += hook;
-      printable_columns[j++] = false;
-    }
-    else
-      s += tee;
+    /* Print the tees and the hooks, and the horizontal lines/spaces. */
+    line += lc[i] ? hook_tail : tee_tail; // lc = last_children()
 
     /* Print the leaves and the inner nodes. */
-    const T& t = *nodes_[i].first;
-    s += hline + spaces;
+    const T& t = value(i);
     if (is_leaf(i))
-      s += pc.print_leaf()(t);
+      append_label(line, pc.print_leaf(), t);
     else
-      s += pc.print_node()(t);
-    printable_columns[j] = true;
-    s += '\n';
+    {
+      append_label(line, pc.print_node(), t);
+      prefix += lc[i] ? blank_column : vline_column; // for the descendants
+      prefix_sizes[depth] = prefix.size();
+    }
+    line += '\n';
+    sink.write(line.data(), line.size());
   }
+}
 
+template <typename T, typename Storage, typename Alloc>
+template <typename Companion>
+std::string Tree<T, Storage, Alloc>::to_string(const Companion& pc) const
+{
+  std::string s;
+  StringSink sink(s);
+  print(sink, pc);
   return s;
 }
 
+template <typename T, typename Storage, typename Alloc>
+const T& Tree<T, Storage, Alloc>::value(size_t id) const
+{
+  return Values::get(values_[id]);
+}
+
 /* Operator overloading. */
 
-  template <typename T>
-std::ostream& operator<<(std::ostream& os, const Tree<T>& tree)
+template <typename T, typename Storage, typename Alloc>
+std::ostream& operator<<(std::ostream& os, const Tree<T, Storage, Alloc>& tree)
 {
-  return os << tree.to_string();
+  tree.print(os);
+  return os;
 }
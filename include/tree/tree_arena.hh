@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <vector>
+
+/* MonotonicArena interface. */
+
+/**
+ * Monotonic arena: memory is handed out by bumping a pointer in large
+ * blocks, and is never freed piecemeal, but all at once by release() (or by
+ * the destructor). This suits trees which are built, used once and dropped
+ * in bulk (e.g., an AST per expression, or a tree per directory scan):
+ * building a tree in an arena costs a few bump allocations instead of one
+ * call to new per array (and per value, with shared values), and dropping it
+ * frees nothing.
+ * Blocks grow geometrically, so an arena holds O(log n) blocks for n bytes.
+ * release() keeps the last (largest) block for reuse, so that an arena
+ * recycled for similar workloads stops allocating after the first round.
+ * An arena is not thread-safe, and cannot be copied. It must outlive all the
+ * objects allocated in it (including the shared pointers to tree values).
+ */
+class MonotonicArena
+{
+  public:
+    /// Constructor. The first block has the given size (in bytes).
+    MonotonicArena(size_t block_size = 4096);
+
+    /// Destructor. Free all blocks.
+    ~MonotonicArena();
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    /**
+     * Allocate n bytes, aligned on the given alignment (a power of 2).
+     * Throw std::bad_alloc if a new block cannot be allocated.
+     */
+    void* allocate(size_t n, size_t alignment);
+
+    /**
+     * Free all the memory allocated so far, at once (all the objects
+     * allocated in the arena must have been destroyed, or be trivially
+     * destructible). The last block is kept for the next allocations.
+     */
+    void release();
+
+    /// Number of blocks currently held by the arena.
+    size_t nb_blocks() const;
+
+    /// Number of bytes handed out since the last release.
+    size_t size() const;
+
+  private:
+    /// Size of the next block to be allocated.
+    size_t next_block_size_;
+
+    /// Blocks, along with the bump pointer and the end of the last block.
+    std::vector<char*> blocks_;
+    std::vector<size_t> block_sizes_;
+    char* current_;
+    char* end_;
+
+    /// Number of bytes handed out since the last release.
+    size_t size_;
+};
+
+/* ArenaAllocator interface. */
+
+/**
+ * Standard-compliant allocator allocating in a MonotonicArena, for use as
+ * the Alloc parameter of trees (e.g., Tree<T, InlineValues,
+ * ArenaAllocator<T>>), or of any standard container.
+ * Deallocation does nothing: the memory is only reclaimed by the arena.
+ * Two allocators compare equal if they use the same arena.
+ */
+template <typename T>
+class ArenaAllocator
+{
+  public:
+    using value_type = T;
+
+    /// Constructor. The arena must outlive the allocator and its allocations.
+    ArenaAllocator(MonotonicArena& arena);
+
+    /// Conversion from an allocator of another type, using the same arena.
+    template <typename U>
+      ArenaAllocator(const ArenaAllocator<U>& other);
+
+    /// Allocate storage for n objects of type T in the arena.
+    T* allocate(size_t n);
+
+    /// Do nothing (see above).
+    void deallocate(T* p, size_t n);
+
+    /// Arena used by the allocator.
+    MonotonicArena& arena() const;
+
+  private:
+    MonotonicArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b);
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b);
+
+#include "tree_arena.hxx" /* template class implementation */
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "tree_arena.hh" /* template class interface */
+
+#include <limits>
+#include <new> // std::bad_alloc
+
+template <typename T>
+ArenaAllocator<T>::ArenaAllocator(MonotonicArena& arena)
+  : arena_(&arena)
+{}
+
+template <typename T>
+template <typename U>
+ArenaAllocator<T>::ArenaAllocator(const ArenaAllocator<U>& other)
+  : arena_(&other.arena())
+{}
+
+template <typename T>
+T* ArenaAllocator<T>::allocate(size_t n)
+{
+  if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+    throw std::bad_alloc();
+  return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+}
+
+template <typename T>
+MonotonicArena& ArenaAllocator<T>::arena() const
+{
+  return *arena_;
+}
+
+template <typename T>
+void ArenaAllocator<T>::deallocate(T*, size_t)
+{}
+
+/* Operator overloading. */
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+  return &a.arena() == &b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+  return !(a == b);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+
+#include "tree.hh"
+
+/* TreeBuilder interface. */
+
+/**
+ * Helper class for building a tree bottom-up in linear time.
+ * The nodes are given in post-order (e.g., the RPN of an arithmetic
+ * expression): a leaf is pushed as a new subtree, and an inner node with
+ * arity r takes the last r pushed subtrees as its children, in the same
+ * order. Nodes are only appended to flat arrays, so no subtree is copied nor
+ * renumbered until build() is called, which does it once for all nodes.
+ * Hence the whole construction of an n-node tree takes O(n) time, whereas
+ * nesting the bottom-to-top constructors of Tree<T> takes O(n * depth).
+ * The built tree has the given storage policy and allocator (see Tree<T>);
+ * the allocator is only used for the built tree, not for the builder's own
+ * arrays (which are freed or reused as usual).
+ */
+template <typename T, typename Storage = SharedValues, \
+    typename Alloc = std::allocator<T>>
+class TreeBuilder
+{
+  public:
+    /**
+     * Constructor. Reserve storage for the given number of nodes, and set
+     * the allocator of the built trees.
+     */
+    TreeBuilder(size_t capacity = 0, const Alloc& alloc = Alloc());
+
+    /// Reserve storage for the given number of nodes.
+    void reserve(size_t capacity);
+
+    /// Push a new subtree reduced to a leaf.
+    void push_leaf(T value);
+
+    /**
+     * Push a new subtree, whose root has the given value, and whose children
+     * are the last 'arity' pushed subtrees (which are no longer pending).
+     * If there are less than 'arity' pending subtrees, throw a
+     * TreeException::EmptyTree exception.
+     */
+    void push_node(T value, size_t arity);
+
+    /// Number of pending subtrees (i.e., which are not a child of any node).
+    size_t nb_subtrees() const;
+
+    /**
+     * Build the tree, and reset the builder.
+     * There must be at most one pending subtree, otherwise a
+     * TreeException::InvalidTable exception is thrown. If there is none,
+     * an empty tree is built.
+     * The second version fills a given tree (which may be a BinaryTree<T>,
+     * provided that all nodes have arity at most 2).
+     */
+    Tree<T, Storage, Alloc> build();
+    void build(Tree<T, Storage, Alloc>& tree);
+
+    /**
+     * Discard the pending subtrees (e.g., when the input turns out to be
+     * invalid), keeping the storage for the next tree.
+     */
+    void clear();
+
+  private:
+    /// Storage policy traits for the node values.
+    using Values = ValueStorage<T, Storage>;
+
+    /// Allocator of the built trees.
+    Alloc alloc_;
+
+    /**
+     * The nodes, stored w.r.t. post-order search: their values, their arities,
+     * and the sizes of the subtrees they root.
+     */
+    std::vector<typename Values::Value> values_;
+    Ids arities_;
+    Ids subtree_sizes_;
+
+    /// Post-order ids of the roots of the pending subtrees.
+    Ids roots_;
+
+    /**
+     * Scratch vectors reused by build(), so that a builder reused for many
+     * trees stops allocating: the children of each node, the pre-order ids
+     * of the nodes, its inverse permutation, and the arities indexed by
+     * pre-order ids.
+     */
+    Ids scratch_;
+    Ids pre_ids_;
+    Ids post_ids_;
+    Ids pre_arities_;
+};
+
+#include "tree_builder.hxx" /* template class implementation */
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "tree_builder.hh" /* template class interface */
+
+#include <algorithm> // std::copy
+#include <utility> // std::move
+
+#include "tree_error.hh"
+
+template <typename T, typename Storage, typename Alloc>
+TreeBuilder<T, Storage, Alloc>::TreeBuilder(size_t capacity, \
+    const Alloc& alloc)
+  : alloc_(alloc)
+{
+  reserve(capacity);
+}
+
+template <typename T, typename Storage, typename Alloc>
+Tree<T, Storage, Alloc> TreeBuilder<T, Storage, Alloc>::build()
+{
+  Tree<T, Storage, Alloc> tree(Table<T>(), alloc_);
+  build(tree);
+  return tree;
+}
+
+template <typename T, typename Storage, typename Alloc>
+void TreeBuilder<T, Storage, Alloc>::build(Tree<T, Storage, Alloc>& tree)
+{
+  if (roots_.size() > 1)
+    throw TreeException::InvalidTable("[ERROR]" \
+        " Calling TreeBuilder<T>::build() failed: Several subtrees left\n");
+
+  size_t n = values_.size();
+  tree.values_.clear();
+  tree.parents_.assign(n, 0);
+  tree.child_offsets_.clear();
+  tree.children_.clear();
+
+  if (n > 0)
+  {
+    /*
+     * Compute the pre-order id of every node. Reading the nodes backwards
+     * from the root, every node comes before its children, so its pre-order
+     * id is already known. Its children are found backwards too, from its
+     * last child (just before it) and then by skipping whole subtrees; the
+     * first child gets the id following its parent's, and each next child the
+     * id following the whole subtree of the previous one.
+     * The children are collected in scratch_, and their pre-order ids
+     * written in pre_ids_.
+     */
+    pre_ids_.assign(n, 0);
+    post_ids_.assign(n, 0);
+    pre_arities_.assign(n, 0);
+    pre_ids_[n - 1] = 0;
+    for (size_t p = n; p-- > 0;)
+    {
+      size_t id = pre_ids_[p];
+      post_ids_[id] = p;
+      pre_arities_[id] = arities_[p];
+
+      scratch_.clear();
+      for (size_t k = 0, c = p - 1; k < arities_[p]; k++)
+      {
+        scratch_.push_back(c);
+        c -= subtree_sizes_[c];
+      }
+
+      size_t next = id + 1;
+      for (size_t k = scratch_.size(); k-- > 0;)
+      {
+        size_t c = scratch_[k];
+        pre_ids_[c] = next;
+        tree.parents_[next] = id;
+        next += subtree_sizes_[c];
+      }
+    }
+
+    /*
+     * Move the values w.r.t. pre-order search (appending them, since inline
+     * values may not be default-constructible).
+     */
+    tree.values_.reserve(n);
+    for (size_t id = 0; id < n; id++)
+      tree.values_.push_back(std::move(values_[post_ids_[id]]));
+
+    /*
+     * Fill the CSR arrays. As children ids are sorted in ascending order,
+     * the children of each node are retrieved by a counting sort of all the
+     * nodes (but the root) w.r.t. their parent ids.
+     */
+    tree.child_offsets_.reserve(n + 1);
+    tree.child_offsets_.push_back(0);
+    for (size_t i = 0; i < n; i++)
+      tree.child_offsets_.push_back( \
+          tree.child_offsets_.back() + pre_arities_[i]);
+    tree.children_.assign(n - 1, 0);
+    Ids& next = pre_arities_; // reused as the next free slot for each parent
+    std::copy(tree.child_offsets_.begin(), tree.child_offsets_.end() - 1, \
+        next.begin());
+    for (size_t i = 1; i < n; i++)
+      tree.children_[next[tree.parents_[i]]++] = i;
+  }
+
+  tree.index_nodes();
+  clear(); // reset the builder
+}
+
+template <typename T, typename Storage, typename Alloc>
+void TreeBuilder<T, Storage, Alloc>::clear()
+{
+  values_.clear();
+  arities_.clear();
+  subtree_sizes_.clear();
+  roots_.clear();
+}
+
+template <typename T, typename Storage, typename Alloc>
+size_t TreeBuilder<T, Storage, Alloc>::nb_subtrees() const
+{
+  return roots_.size();
+}
+
+template <typename T, typename Storage, typename Alloc>
+void TreeBuilder<T, Storage, Alloc>::push_leaf(T value)
+{
+  push_node(std::move(value), 0);
+}
+
+template <typename T, typename Storage, typename Alloc>
+void TreeBuilder<T, Storage, Alloc>::push_node(T value, size_t arity)
+{
+  if (roots_.size() < arity)
+    throw TreeException::EmptyTree("[ERROR]" \
+        " Calling TreeBuilder<T>::push_node() failed: Missing subtrees\n");
+
+  /* The last 'arity' pending subtrees lie just before the new node. */
+  size_t size = 1;
+  for (size_t k = 0; k < arity; k++)
+  {
+    size += subtree_sizes_[roots_.back()];
+    roots_.pop_back();
+  }
+
+  roots_.push_back(values_.size());
+  values_.push_back(Values::make(std::move(value), alloc_));
+  arities_.push_back(arity);
+  subtree_sizes_.push_back(size);
+}
+
+template <typename T, typename Storage, typename Alloc>
+void TreeBuilder<T, Storage, Alloc>::reserve(size_t capacity)
+{
+  values_.reserve(capacity);
+  arities_.reserve(capacity);
+  subtree_sizes_.reserve(capacity);
+}
@@ -5,8 +5,9 @@
 #include <string>
 
 /*
- * A very simple exception handler for empty trees,
- * or trees constructed from invalid tables.
+ * A very simple exception handler for empty trees, invalid node ids,
+ * or trees constructed from invalid tables (or mapped from invalid
+ * snapshots).
  */
 namespace TreeException
 {
@@ -22,9 +23,21 @@ namespace TreeException
     EmptyTree(const std::string& message = "");
   };
 
+  /// BaseException/NoSuchNode
+  struct NoSuchNode : public BaseException
+  {
+    NoSuchNode(const std::string& message = "");
+  };
+
   /// BaseException/InvalidTable
   struct InvalidTable : public BaseException
   {
     InvalidTable(const std::string& message = "");
   };
+
+  /// BaseException/InvalidSnapshot
+  struct InvalidSnapshot : public BaseException
+  {
+    InvalidSnapshot(const std::string& message = "");
+  };
 }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef> // std::ptrdiff_t
+#include <iterator> // std::forward_iterator_tag
+#include <limits>
+#include <vector>
+
+#include "tree_storage.hh"
+
+/**
+ * Tags for the traversal orders supported by TreeIterator<T, Order>.
+ * InOrder only makes sense for binary trees (see BinaryTree<T>).
+ */
+struct PreOrder {};
+struct PostOrder {};
+struct BreadthFirstOrder {};
+struct InOrder {};
+
+/* TreeIterator interface. */
+
+/**
+ * STL-compatible forward iterator over the nodes of a tree (or of the subtree
+ * rooted at a given node), w.r.t. a given traversal order.
+ * Nodes are visited lazily: nothing is computed nor allocated beforehand, so
+ * stopping a traversal early costs nothing.
+ * Dereferencing yields a const reference to the node value, and id() yields
+ * the node id.
+ * Thanks to the pre-order layout of the nodes and to the cached metadata,
+ * pre-order, post-order and in-order traversals are made without any stack
+ * (each step takes O(1) amortized time). Breadth-first traversal needs a
+ * queue, which only holds the nodes whose children are still to be visited
+ * (its storage is allocated once, and reused along the traversal).
+ * The tree must outlive the iterator.
+ * The Storage parameter is the storage policy of the tree.
+ */
+template <typename T, typename Order, typename Storage = SharedValues, \
+    typename Alloc = std::allocator<T>>
+class TreeIterator
+{
+  public:
+  /// Iterator traits.
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const T*;
+  using reference = const T&;
+
+  /// Past-the-end id.
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  /// Constructor: past-the-end iterator.
+  TreeIterator();
+
+  /**
+   * Constructor: iterator on the first node of the subtree rooted at the
+   * given node. If the tree is empty, this is the past-the-end iterator.
+   */
+  TreeIterator(const Tree<T, Storage, Alloc>& tree, size_t root = 0);
+
+  /// Id of the current node.
+  size_t id() const;
+
+  /// Usual iterator operations.
+  reference operator*() const;
+  pointer operator->() const;
+  TreeIterator& operator++();
+  TreeIterator operator++(int);
+  bool operator==(const TreeIterator& other) const;
+  bool operator!=(const TreeIterator& other) const;
+
+  private:
+  /// Traversed tree, root of the traversed subtree, and current node id.
+  const Tree<T, Storage, Alloc>* tree_;
+  size_t root_;
+  size_t id_;
+
+  /**
+   * Breadth-first traversal only: queue of the visited nodes whose children
+   * are still to be visited, implemented as a vector and the index of its
+   * front.
+   */
+  std::vector<size_t> queue_;
+  size_t front_;
+
+  /// Go to the first node, w.r.t. each order.
+  void first(PreOrder);
+  void first(PostOrder);
+  void first(BreadthFirstOrder);
+  void first(InOrder);
+
+  /// Go to the next node, w.r.t. each order.
+  void next(PreOrder);
+  void next(PostOrder);
+  void next(BreadthFirstOrder);
+  void next(InOrder);
+
+  /// Go down from the current node, following the first (or left) children.
+  void descend_first_children();
+  void descend_left_children();
+};
+
+/* TreeRange interface. */
+
+/**
+ * Range of nodes of a tree (or of a subtree) w.r.t. a given traversal order,
+ * for use in range-based for loops and STL algorithms.
+ */
+template <typename T, typename Order, typename Storage = SharedValues, \
+    typename Alloc = std::allocator<T>>
+class TreeRange
+{
+  public:
+  /// Constructor: traverse the subtree rooted at the given node.
+  TreeRange(const Tree<T, Storage, Alloc>& tree, size_t root = 0);
+
+  TreeIterator<T, Order, Storage, Alloc> begin() const;
+  TreeIterator<T, Order, Storage, Alloc> end() const;
+
+  private:
+  const Tree<T, Storage, Alloc>* tree_;
+  size_t root_;
+};
+
+#include "tree_iterator.hxx" /* template class implementation */
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "tree_iterator.hh" /* template class interface */
+
+/* TreeIterator implementation. */
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+constexpr size_t TreeIterator<T, Order, Storage, Alloc>::npos;
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeIterator<T, Order, Storage, Alloc>::TreeIterator()
+  : tree_(nullptr), root_(npos), id_(npos), front_(0)
+{}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeIterator<T, Order, Storage, Alloc>::TreeIterator( \
+    const Tree<T, Storage, Alloc>& tree, size_t root)
+  : tree_(&tree), root_(root), id_(npos), front_(0)
+{
+  if (root < tree.size())
+    first(Order{});
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::descend_first_children()
+{
+  /* In pre-order, the first child of a node comes just after it. */
+  while (tree_->arity(id_) > 0)
+    id_++;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::descend_left_children()
+{
+  /* Recall that a node with only 1 child has no left child. */
+  while (tree_->arity(id_) == 2)
+    id_++;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::first(PreOrder)
+{
+  id_ = root_;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::first(PostOrder)
+{
+  id_ = root_;
+  descend_first_children();
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::first(BreadthFirstOrder)
+{
+  id_ = root_;
+  queue_.push_back(root_);
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::first(InOrder)
+{
+  id_ = root_;
+  descend_left_children();
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+size_t TreeIterator<T, Order, Storage, Alloc>::id() const
+{
+  return id_;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::next(PreOrder)
+{
+  /* Nodes are stored w.r.t. pre-order search. */
+  id_++;
+  if (id_ >= root_ + tree_->subtree_sizes_[root_])
+    id_ = npos;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::next(PostOrder)
+{
+  /*
+   * A parent comes just after its last child. Otherwise, the next node is the
+   * first leaf (following the first children) of the next sibling, which
+   * comes just after the whole subtree of the current node in pre-order.
+   */
+  if (id_ == root_)
+    id_ = npos;
+  else if (tree_->last_children_[id_])
+    id_ = tree_->parents_[id_];
+  else
+  {
+    id_ += tree_->subtree_sizes_[id_];
+    descend_first_children();
+  }
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::next(BreadthFirstOrder)
+{
+  /* Enqueue the children of the current node, which is dequeued. */
+  size_t id = queue_[front_++];
+  for (size_t k = 0; k < tree_->arity(id); k++)
+    queue_.push_back(tree_->child(id, k));
+
+  /* Reuse the storage of the queue, once its first half is dequeued. */
+  if (front_ > queue_.size() / 2)
+  {
+    queue_.erase(queue_.begin(), queue_.begin() + front_);
+    front_ = 0;
+  }
+
+  id_ = (front_ < queue_.size()) ? queue_[front_] : npos;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+void TreeIterator<T, Order, Storage, Alloc>::next(InOrder)
+{
+  /*
+   * If the current node has a right child, the next node is the leftmost
+   * node in its subtree. Otherwise, go up until coming from a left child:
+   * the next node is the corresponding parent.
+   */
+  size_t arity = tree_->arity(id_);
+  if (arity > 0)
+  {
+    id_ = tree_->child(id_, arity - 1);
+    descend_left_children();
+    return;
+  }
+
+  while (id_ != root_)
+  {
+    size_t parent = tree_->parents_[id_];
+    if (tree_->arity(parent) == 2 and id_ == parent + 1) // id_ is a left child
+    {
+      id_ = parent;
+      return;
+    }
+    id_ = parent;
+  }
+  id_ = npos;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+typename TreeIterator<T, Order, Storage, Alloc>::reference
+TreeIterator<T, Order, Storage, Alloc>::operator*() const
+{
+  return tree_->value(id_);
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+typename TreeIterator<T, Order, Storage, Alloc>::pointer
+TreeIterator<T, Order, Storage, Alloc>::operator->() const
+{
+  return &tree_->value(id_);
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeIterator<T, Order, Storage, Alloc>&
+TreeIterator<T, Order, Storage, Alloc>::operator++()
+{
+  next(Order{});
+  return *this;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeIterator<T, Order, Storage, Alloc>
+TreeIterator<T, Order, Storage, Alloc>::operator++(int)
+{
+  auto old = *this;
+  next(Order{});
+  return old;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+bool TreeIterator<T, Order, Storage, Alloc>::operator==( \
+    const TreeIterator& other) const
+{
+  return id_ == other.id_;
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+bool TreeIterator<T, Order, Storage, Alloc>::operator!=( \
+    const TreeIterator& other) const
+{
+  return id_ != other.id_;
+}
+
+/* TreeRange implementation. */
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeRange<T, Order, Storage, Alloc>::TreeRange( \
+    const Tree<T, Storage, Alloc>& tree, size_t root)
+  : tree_(&tree), root_(root)
+{}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeIterator<T, Order, Storage, Alloc>
+TreeRange<T, Order, Storage, Alloc>::begin() const
+{
+  return TreeIterator<T, Order, Storage, Alloc>(*tree_, root_);
+}
+
+template <typename T, typename Order, typename Storage, typename Alloc>
+TreeIterator<T, Order, Storage, Alloc>
+TreeRange<T, Order, Storage, Alloc>::end() const
+{
+  return TreeIterator<T, Order, Storage, Alloc>();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional> // std::function
+#include <string>
 
 /// Type alias for functions mapping T to std::string
 template <typename T>
@@ -28,10 +29,10 @@ class TreePrintCompanion
         unsigned dashes = 2, \
         unsigned spaces = 1);
 
-    /// Trivial getters.
-    PrintFunction<T> print_leaf() const;
-    PrintFunction<T> print_node() const;
-    PrintFunction<T> print_root() const;
+    /// Trivial getters (by reference, so no std::function is copied).
+    const PrintFunction<T>& print_leaf() const;
+    const PrintFunction<T>& print_node() const;
+    const PrintFunction<T>& print_root() const;
     unsigned dashes() const;
     unsigned spaces() const;
 
@@ -44,4 +45,56 @@ class TreePrintCompanion
     const unsigned spaces_;
 };
 
+/* TreePrintPolicy interface. */
+
+/**
+ * Compile-time variant of TreePrintCompanion: the printing functions are
+ * stored as callables of any type (e.g., lambdas), given as template
+ * parameters. Their calls are thus resolved at compile time and can be
+ * inlined, whereas calling a std::function is an indirect call.
+ * Every printing function either maps a node value (const T&) to a
+ * std::string, as in TreePrintCompanion, or is a formatter which appends the
+ * representation of a node value to a caller buffer, with the signature
+ * void(const T&, std::string&): the latter avoids making a new string for
+ * every node.
+ * A TreePrintPolicy can be passed in anywhere a TreePrintCompanion is
+ * expected for printing; use make_print_policy() to construct it.
+ */
+template <typename Leaf, typename Node, typename Root>
+class TreePrintPolicy
+{
+  public:
+    /// Trivial constructor.
+    TreePrintPolicy(const Leaf& print_leaf, const Node& print_node, \
+        const Root& print_root, unsigned dashes = 2, unsigned spaces = 1);
+
+    /// Trivial getters.
+    const Leaf& print_leaf() const;
+    const Node& print_node() const;
+    const Root& print_root() const;
+    unsigned dashes() const;
+    unsigned spaces() const;
+
+  private:
+    /// Attributes, as for TreePrintCompanion.
+    Leaf print_leaf_;
+    Node print_node_;
+    Root print_root_;
+    const unsigned dashes_;
+    const unsigned spaces_;
+};
+
+/// Construct a TreePrintPolicy, deducing the types of the callables.
+template <typename Leaf, typename Node, typename Root>
+TreePrintPolicy<Leaf, Node, Root> make_print_policy(const Leaf& print_leaf, \
+    const Node& print_node, const Root& print_root, \
+    unsigned dashes = 2, unsigned spaces = 1);
+
+/**
+ * Append the representation of a node value t, given by a printing function
+ * f (either a formatter or a function returning a std::string), to s.
+ */
+template <typename F, typename T>
+void append_label(std::string& s, const F& f, const T& t);
+
 #include "tree_pc.hxx" /* template class implementation */
@@ -36,19 +36,19 @@ TreePrintCompanion<T>::TreePrintCompanion( \
 {}
 
 template <typename T>
-PrintFunction<T> TreePrintCompanion<T>::print_leaf() const
+const PrintFunction<T>& TreePrintCompanion<T>::print_leaf() const
 {
   return print_leaf_;
 }
 
 template <typename T>
-PrintFunction<T> TreePrintCompanion<T>::print_node() const
+const PrintFunction<T>& TreePrintCompanion<T>::print_node() const
 {
   return print_node_;
 }
 
 template <typename T>
-PrintFunction<T> TreePrintCompanion<T>::print_root() const
+const PrintFunction<T>& TreePrintCompanion<T>::print_root() const
 {
   return print_root_;
 }
@@ -64,3 +64,77 @@ unsigned TreePrintCompanion<T>::spaces() const
 {
   return spaces_;
 }
+
+/* TreePrintPolicy implementation. */
+
+template <typename Leaf, typename Node, typename Root>
+TreePrintPolicy<Leaf, Node, Root>::TreePrintPolicy( \
+    const Leaf& print_leaf, \
+    const Node& print_node, \
+    const Root& print_root, \
+    unsigned dashes, \
+    unsigned spaces)
+: print_leaf_(print_leaf), print_node_(print_node), print_root_(print_root), \
+    dashes_(dashes), spaces_(spaces)
+{}
+
+template <typename Leaf, typename Node, typename Root>
+const Leaf& TreePrintPolicy<Leaf, Node, Root>::print_leaf() const
+{
+  return print_leaf_;
+}
+
+template <typename Leaf, typename Node, typename Root>
+const Node& TreePrintPolicy<Leaf, Node, Root>::print_node() const
+{
+  return print_node_;
+}
+
+template <typename Leaf, typename Node, typename Root>
+const Root& TreePrintPolicy<Leaf, Node, Root>::print_root() const
+{
+  return print_root_;
+}
+
+template <typename Leaf, typename Node, typename Root>
+unsigned TreePrintPolicy<Leaf, Node, Root>::dashes() const
+{
+  return dashes_;
+}
+
+template <typename Leaf, typename Node, typename Root>
+unsigned TreePrintPolicy<Leaf, Node, Root>::spaces() const
+{
+  return spaces_;
+}
+
+template <typename Leaf, typename Node, typename Root>
+TreePrintPolicy<Leaf, Node, Root> make_print_policy(const Leaf& print_leaf, \
+    const Node& print_node, const Root& print_root, \
+    unsigned dashes, unsigned spaces)
+{
+  return {print_leaf, print_node, print_root, dashes, spaces};
+}
+
+/*
+ * Tag dispatch for append_label(): the int overload (preferred) is only
+ * viable for formatters, thanks to SFINAE on the trailing return type.
+ */
+template <typename F, typename T>
+auto append_label(std::string& s, const F& f, const T& t, int) \
+  -> decltype(f(t, s), void())
+{
+  f(t, s);
+}
+
+template <typename F, typename T>
+void append_label(std::string& s, const F& f, const T& t, long)
+{
+  s += f(t);
+}
+
+template <typename F, typename T>
+void append_label(std::string& s, const F& f, const T& t)
+{
+  append_label(s, f, t, 0);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Sinks for streaming the pretty-printing of trees (see Tree<T>::print()).
+ * A sink is any object with a method write(const char* s, size_t n) appending
+ * the n characters starting at s to its output: std::ostream is a sink, and
+ * so is the StringSink below. Callers may provide their own sinks (e.g., with
+ * a fixed-size buffer flushed to a file descriptor).
+ */
+
+/// Sink appending to a std::string.
+class StringSink
+{
+  public:
+    /// Constructor. The string must outlive the sink.
+    StringSink(std::string& s)
+      : s_(s)
+    {}
+
+    void write(const char* s, size_t n)
+    {
+      s_.append(s, n);
+    }
+
+  private:
+    std::string& s_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory> // std::shared_ptr
+#include <utility> // std::move
+
+/**
+ * Storage policies for the node values of a tree.
+ * SharedValues (default): every value is stored behind a shared pointer,
+ * so trees, subtrees and traversal results can share their values.
+ * InlineValues: values are stored contiguously by value, without any
+ * control block nor indirection. This is much cheaper for small types
+ * (e.g. int, or short strings). Shared ownership then becomes opt-in: the
+ * methods returning shared pointers (e.g. root_value(), or the searches)
+ * return non-owning pointers, which are only valid as long as the tree is.
+ */
+struct SharedValues {};
+struct InlineValues {};
+
+/**
+ * Forward declarations, along with the default template arguments.
+ * Alloc is the allocator used for all the storage of a tree (please refer to
+ * the "tree_arena.hh" header file for a monotonic arena allocator).
+ */
+template <typename T, typename Storage = SharedValues, \
+    typename Alloc = std::allocator<T>>
+class Tree;
+template <typename T, typename Storage = SharedValues, \
+    typename Alloc = std::allocator<T>>
+class BinaryTree;
+template <typename T>
+class MappedTree;
+
+/// Allocator of type Alloc, rebound to the type U.
+template <typename Alloc, typename U>
+using RebindAlloc = typename std::allocator_traits<Alloc>::template \
+    rebind_alloc<U>;
+
+/**
+ * Traits implementing the storage policies. For every policy:
+ * - Value: type of the stored values;
+ * - make(t, alloc): make a stored value from a value, using the allocator
+ *   of the tree if the value is allocated on its own;
+ * - adopt(p): make a stored value from a shared pointer (as in tables);
+ * - get(v): reference to the value;
+ * - share(v): shared pointer to the value.
+ */
+template <typename T, typename Storage>
+struct ValueStorage;
+
+template <typename T>
+struct ValueStorage<T, SharedValues>
+{
+  using Value = std::shared_ptr<T>;
+
+  template <typename Alloc>
+  static Value make(T t, const Alloc& alloc)
+  {
+    return std::allocate_shared<T>(RebindAlloc<Alloc, T>(alloc), \
+        std::move(t));
+  }
+
+  static Value adopt(const std::shared_ptr<T>& p)
+  {
+    return p;
+  }
+
+  static const T& get(const Value& v)
+  {
+    return *v;
+  }
+
+  static std::shared_ptr<T> share(const Value& v)
+  {
+    return v;
+  }
+};
+
+template <typename T>
+struct ValueStorage<T, InlineValues>
+{
+  using Value = T;
+
+  template <typename Alloc>
+  static Value make(T t, const Alloc&)
+  {
+    return t;
+  }
+
+  static Value adopt(const std::shared_ptr<T>& p)
+  {
+    return *p;
+  }
+
+  static const T& get(const Value& v)
+  {
+    return v;
+  }
+
+  /// Non-owning pointer: aliasing constructor with an empty owner.
+  static std::shared_ptr<T> share(const Value& v)
+  {
+    return std::shared_ptr<T>(std::shared_ptr<T>(), const_cast<T*>(&v));
+  }
+};
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio> // std::printf
+#include <cstdlib> // std::malloc, std::free
+#include <new> // std::bad_alloc
+
+#include "../../include/tree/tree_arena.hh"
+#include "../../include/tree/tree_builder.hh"
+
+/*
+ * Benchmark of the allocations made for trees which are built, traversed
+ * once and dropped (e.g., the AST of an expression): 10^5 trees of 51 nodes
+ * are built by a reused TreeBuilder, with shared or inline values, with the
+ * default allocator or in a MonotonicArena (released after every tree).
+ * The calls to operator new are counted by replacing it below.
+ * Usage: alloc [NB_TREES] (default: 10^5).
+ */
+
+/// Number of calls to operator new so far.
+static size_t nb_news = 0;
+
+void* operator new(size_t size)
+{
+  nb_news++;
+  if (void* p = std::malloc(size > 0 ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+/**
+ * Build and traverse 'nb_trees' trees of 51 nodes (a root, 10 children and 4
+ * leaves per child) with a builder, calling release() after every tree, and
+ * print the numbers of calls to operator new and the time per tree.
+ */
+template <typename Builder, typename Release>
+static void run(const char* name, Builder& builder, size_t nb_trees, \
+    Release release)
+{
+  long sum = 0;
+  const size_t nb_news_before = nb_news;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < nb_trees; i++)
+  {
+    {
+      for (int child = 0; child < 10; child++)
+      {
+        for (int leaf = 0; leaf < 4; leaf++)
+          builder.push_leaf(leaf);
+        builder.push_node(child, 4);
+      }
+      builder.push_node(-1, 10);
+      const auto tree = builder.build();
+      for (const auto& value : tree.pre_order())
+        sum += value;
+    }
+    release();
+  }
+  const std::chrono::duration<double, std::nano> time = \
+    std::chrono::steady_clock::now() - start;
+  std::printf("%-28s %10.2f %10.0f\n", name, \
+      static_cast<double>(nb_news - nb_news_before) / nb_trees, \
+      time.count() / nb_trees);
+  if (sum != 104 * static_cast<long>(nb_trees)) // 10 x (0+1+2+3) + 45 - 1
+    std::abort();
+}
+
+int main(int argc, char** argv)
+{
+  const size_t nb_trees = argc > 1 ? std::stoul(argv[1]) : 100000;
+  MonotonicArena arena;
+  const ArenaAllocator<int> alloc(arena);
+  auto release = [&arena]() { arena.release(); };
+  auto nothing = []() {};
+
+  TreeBuilder<int, SharedValues> shared(51);
+  TreeBuilder<int, SharedValues, ArenaAllocator<int>> shared_arena(51, alloc);
+  TreeBuilder<int, InlineValues> inline_values(51);
+  TreeBuilder<int, InlineValues, ArenaAllocator<int>> \
+    inline_arena(51, alloc);
+
+  std::printf("%zu trees of 51 nodes\n", nb_trees);
+  std::printf("%-28s %10s %10s\n", "", "news/tree", "ns/tree");
+  run("shared values", shared, nb_trees, nothing);
+  run("shared values, arena", shared_arena, nb_trees, release);
+  run("inline values", inline_values, nb_trees, nothing);
+  run("inline values, arena", inline_arena, nb_trees, release);
+  return 0;
+}
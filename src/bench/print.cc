@@ -0,0 +1,129 @@
+#include <algorithm> // std::min
+#include <chrono>
+#include <cstdio> // std::printf
+#include <cstdlib> // std::abort
+#include <string>
+
+#include "../../include/tree/tree_builder.hh"
+
+/*
+ * Benchmark of the pretty-printing of a demo-style tree (int values, shared
+ * storage) w.r.t. its printing functions: to_string() with a policy copying
+ * a std::function for every node (as the TreePrintCompanion getters did,
+ * returning them by value), with a TreePrintCompanion, and with a
+ * TreePrintPolicy of functions returning strings, or of formatters.
+ * print() to a null sink, with the default (constant) labels, is measured
+ * too.
+ * Usage: print [SIZE] (default: 10^6 nodes).
+ */
+
+/// Maximal number of children of the nodes of the benchmarked tree.
+static const size_t fan_out = 10;
+
+/**
+ * Push to a builder a subtree of 'size' nodes, in post-order: its root has up
+ * to fan_out children, between which the other nodes are split evenly. The
+ * values are the post-order ids of the nodes, starting at 'next'.
+ */
+static void push_subtree(TreeBuilder<int>& builder, size_t size, int& next)
+{
+  const size_t arity = std::min(fan_out, size - 1);
+  size_t rest = size - 1;
+  for (size_t k = arity; k > 0; k--)
+  {
+    push_subtree(builder, rest / k, next);
+    rest -= rest / k;
+  }
+  builder.push_node(next++, arity);
+}
+
+/// Printing function copying a std::function for every node it prints.
+struct CopyingPrint
+{
+  PrintFunction<int> f;
+
+  std::string operator()(const int& t) const
+  {
+    const PrintFunction<int> copy = f;
+    return copy(t);
+  }
+};
+
+/// Sink discarding its input, but for its size.
+struct NullSink
+{
+  size_t size = 0;
+
+  void write(const char*, size_t n)
+  {
+    size += n;
+  }
+};
+
+/// Best time (in milliseconds) of a few runs of f().
+template <typename F>
+static double best_time(F f)
+{
+  double best = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double, std::milli> time = \
+      std::chrono::steady_clock::now() - start;
+    if (i == 0 or time.count() < best)
+      best = time.count();
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  const size_t size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  TreeBuilder<int> builder(size);
+  int next = 0;
+  push_subtree(builder, size, next);
+  const Tree<int> tree = builder.build();
+
+  /* Printing functions. */
+  auto print = [](const int& t) { return std::to_string(t); };
+  auto format = [](const int& t, std::string& s)
+  {
+    char buffer[16];
+    char* begin = buffer + sizeof(buffer);
+    unsigned u = t < 0 ? -static_cast<unsigned>(t) : t;
+    do
+      *--begin = '0' + u % 10;
+    while ((u /= 10) > 0);
+    if (t < 0)
+      *--begin = '-';
+    s.append(begin, buffer + sizeof(buffer));
+  };
+  const CopyingPrint copying{print};
+  const auto copying_policy = make_print_policy(copying, copying, copying);
+  const TreePrintCompanion<int> companion(print, print, print);
+  const auto policy = make_print_policy(print, print, print);
+  const auto formatters = make_print_policy(format, format, format);
+
+  /* Every representation must be the same. */
+  const std::string expected = tree.to_string(companion);
+  if (tree.to_string(copying_policy) != expected \
+      or tree.to_string(policy) != expected \
+      or tree.to_string(formatters) != expected)
+    std::abort();
+
+  size_t total = 0;
+  std::printf("%zu nodes, %zu bytes\n", tree.size(), expected.size());
+  std::printf("to_string(), std::function copied per node: %8.1f ms\n", \
+      best_time([&]() { total += tree.to_string(copying_policy).size(); }));
+  std::printf("to_string(), TreePrintCompanion:            %8.1f ms\n", \
+      best_time([&]() { total += tree.to_string(companion).size(); }));
+  std::printf("to_string(), TreePrintPolicy:               %8.1f ms\n", \
+      best_time([&]() { total += tree.to_string(policy).size(); }));
+  std::printf("to_string(), TreePrintPolicy of formatters: %8.1f ms\n", \
+      best_time([&]() { total += tree.to_string(formatters).size(); }));
+  NullSink sink;
+  std::printf("print(), constant labels, null sink:        %8.1f ms\n", \
+      best_time([&]() { tree.print(sink); }));
+  return total + sink.size > 0 ? 0 : 1;
+}
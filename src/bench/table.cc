@@ -0,0 +1,104 @@
+#include <algorithm> // std::min
+#include <chrono>
+#include <cstdio> // std::printf
+#include <cstdlib> // std::abort
+#include <string>
+
+#include "../../include/tree/tree.hh"
+
+/*
+ * Benchmark of Tree<T>::Tree(const Table<T>&), w.r.t. the size of the table:
+ * the children are resolved either by a linear scan of the keys (T has no
+ * std::hash, as std::string before the SymbolIndex), by std::hash<T> (the
+ * children are distinct pointers to copies of the keys), or by the
+ * addresses of the keys (the children are the keys themselves, as in rd).
+ * Usage: table [MAX_SIZE [MAX_LINEAR_SIZE]] (default: 10^6 and 32000).
+ */
+
+/// Node value without std::hash, so that its table is read by linear scans.
+struct Name
+{
+  std::string name;
+
+  bool operator==(const Name& other) const
+  {
+    return name == other.name;
+  }
+};
+
+/// Maximal number of children of the nodes of the benchmarked trees.
+static const size_t fan_out = 10;
+
+/**
+ * Append to a table the rows of a subtree of 'size' nodes, in pre-order: its
+ * root has up to fan_out children, between which the other nodes are split
+ * evenly. The children are the keys of their rows if 'shared' is set, and
+ * distinct copies otherwise.
+ */
+template <typename T, typename Make>
+static void fill(Table<T>& table, size_t size, bool shared, Make make)
+{
+  const size_t row = table.size();
+  table.push_back({std::make_shared<T>(make(row)), {}});
+  size_t rest = size - 1;
+  for (size_t k = std::min(fan_out, rest); k > 0; k--)
+  {
+    const size_t child_size = rest / k;
+    const size_t child_row = table.size();
+    fill(table, child_size, shared, make);
+    const auto& key = table[child_row].first;
+    table[row].second.push_back(shared ? key : std::make_shared<T>(*key));
+    rest -= child_size;
+  }
+}
+
+/// Best time (in seconds) of a few constructions of a tree from a table.
+template <typename T, typename Make>
+static double construction_time(size_t size, bool shared, Make make)
+{
+  Table<T> table;
+  table.reserve(size);
+  fill(table, size, shared, make);
+
+  double best = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    const Tree<T> tree(table);
+    const std::chrono::duration<double> time = \
+      std::chrono::steady_clock::now() - start;
+    if (tree.size() != size)
+      std::abort();
+    if (i == 0 or time.count() < best)
+      best = time.count();
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  const size_t max_size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  const size_t max_linear_size = argc > 2 ? std::stoul(argv[2]) : 32000;
+  auto string_name = [](size_t row) { return std::to_string(row); };
+  auto unhashed_name = [](size_t row) { return Name{std::to_string(row)}; };
+
+  std::printf("%10s %12s %12s %12s\n", "size", "linear (s)", "hash (s)", \
+      "shared (s)");
+  for (size_t size : {1000, 2000, 4000, 8000, 16000, 32000, 64000, 125000, \
+      250000, 500000, 1000000})
+  {
+    if (size > max_size)
+      break;
+    std::printf("%10zu ", size);
+    if (size <= max_linear_size)
+      std::printf("%12.4f ", \
+          construction_time<Name>(size, false, unhashed_name));
+    else
+      std::printf("%12s ", "-");
+    std::printf("%12.4f %12.4f\n", \
+        construction_time<std::string>(size, false, string_name), \
+        construction_time<std::string>(size, true, string_name));
+    std::fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,281 @@
+#include <algorithm> // std::copy_n
+#include <chrono>
+#include <csignal> // std::raise, SIGSTOP, SIGTRAP
+#include <cstdio> // std::printf, std::perror
+#include <cstdlib> // std::exit
+#include <stack>
+#include <string>
+#include <utility> // std::pair
+
+#include <dirent.h> // opendir, readdir, closedir
+#include <sys/resource.h> // struct rusage
+#include <sys/stat.h> // mkdir, lstat
+#include <sys/wait.h> // wait4, waitpid
+#include <unistd.h> // fork, pipe, read, write, _exit
+
+#include "../../include/rd/reader.hh"
+
+/*
+ * Benchmark of the serial directory search of rd, on a directory tree:
+ * the portable search (every directory opened by its whole path with
+ * opendir(), and read by readdir() into a table of shared paths, from which
+ * the tree is built), and DirectoryReader::tree() (walk(), with openat() and
+ * getdents64() on Linux). Every search builds the tree of basenames in a
+ * child process, which is run twice: once for the times, and once traced
+ * with ptrace() to count its system calls (on x86-64 only). The page cache
+ * is not dropped between the searches: run it on a tree which does not fit
+ * in the cache, or twice on a small tree for warm measures.
+ * Usage: walk [--create] [--no-count] DIR
+ * With --create, the synthetic tree DIR/d0/d0/d0, ..., DIR/d99/d99/d99
+ * (1,010,101 directories) is made first (the existing directories are kept).
+ */
+
+/* Portable search (see DirectoryReader::list_entries() and table()). */
+
+/// Paths of the visible subdirectories of a directory.
+static std::vector<Ptr<String>> subdirectories(const String& dir)
+{
+  std::vector<Ptr<String>> out;
+  DIR* dirp = opendir(dir.c_str());
+  if (!dirp)
+    return out;
+  dirent* dp = nullptr;
+  while ((dp = readdir(dirp)) != nullptr)
+  {
+    if (dp->d_name[0] == '.')
+      continue;
+    String path = dir + "/" + dp->d_name;
+    unsigned char type = dp->d_type;
+    struct stat status;
+    if (type == DT_UNKNOWN and lstat(path.c_str(), &status) == 0)
+      type = S_ISDIR(status.st_mode) ? DT_DIR : DT_REG;
+    if (type == DT_DIR)
+      out.push_back(std::make_shared<String>(std::move(path)));
+  }
+  closedir(dirp);
+  return out;
+}
+
+/// Tree of the basenames of the directories, built from a table of paths.
+static size_t readdir_search(const String& top)
+{
+  std::stack<Ptr<String>> s;
+  Table<String> table;
+  s.push(std::make_shared<String>(top));
+  while (!s.empty())
+  {
+    const auto dir = s.top();
+    s.pop();
+    const auto subdirs = subdirectories(*dir);
+    table.push_back({dir, subdirs});
+    for (auto rit = subdirs.rbegin(); rit != subdirs.rend(); rit++)
+      s.push(*rit);
+  }
+  auto basename = [&top](const String& path)
+  {
+    return path.size() == top.size() ? path : \
+      path.substr(path.rfind('/') + 1);
+  };
+  return Tree<String, InlineValues>(table).map<String>(basename).size();
+}
+
+/// Same as above, with DirectoryReader::tree().
+static size_t walk_search(const String& top)
+{
+  return DirectoryReader(top).tree().size();
+}
+
+/* Measures. */
+
+/// Kinds of system calls counted, along with the total.
+enum Syscall
+{
+  all_calls,
+  open_calls,
+  getdents_calls,
+  stat_calls,
+  close_calls,
+  nb_syscalls
+};
+
+/// Whether the system calls can be counted (see count_syscalls()).
+#if defined(__linux__) and defined(__x86_64__)
+#include <sys/ptrace.h>
+#include <sys/syscall.h> // SYS_* constants
+#include <sys/user.h> // struct user_regs_struct
+
+static const bool can_count = true;
+#else
+static const bool can_count = false;
+#endif
+
+/// Measures of a search.
+struct Measures
+{
+  size_t nb_dirs;
+  double wall, user, sys; // in seconds
+  long syscalls[nb_syscalls];
+};
+
+/// Count the system calls of a stopped child process, until it exits.
+static void count_syscalls(pid_t pid, long* syscalls)
+{
+#if defined(__linux__) and defined(__x86_64__)
+  ptrace(PTRACE_SETOPTIONS, pid, 0, \
+      PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+  bool entry = true; // the next system call stop is an entry
+  int signal = 0, status;
+  while (ptrace(PTRACE_SYSCALL, pid, 0, signal) == 0 \
+      and waitpid(pid, &status, 0) == pid and WIFSTOPPED(status))
+  {
+    signal = 0;
+    if (WSTOPSIG(status) != (SIGTRAP | 0x80))
+    {
+      signal = WSTOPSIG(status); // deliver the other signals
+      continue;
+    }
+    if (entry)
+    {
+      user_regs_struct registers;
+      ptrace(PTRACE_GETREGS, pid, 0, &registers);
+      const auto number = registers.orig_rax;
+      syscalls[all_calls]++;
+      if (number == SYS_open or number == SYS_openat)
+        syscalls[open_calls]++;
+      else if (number == SYS_getdents64 or number == SYS_getdents)
+        syscalls[getdents_calls]++;
+      else if (number == SYS_fstat or number == SYS_newfstatat \
+          or number == SYS_lstat or number == SYS_stat)
+        syscalls[stat_calls]++;
+      else if (number == SYS_close)
+        syscalls[close_calls]++;
+    }
+    entry = !entry;
+  }
+#else
+  (void) syscalls;
+  waitpid(pid, nullptr, 0);
+#endif
+}
+
+/**
+ * Run a search of a directory in a child process, and return its measures:
+ * its times, or its system calls if 'count' is set.
+ */
+static Measures measure(size_t (*search)(const String&), const String& dir, \
+    bool count)
+{
+  Measures measures = {0, 0, 0, 0, {0}};
+  int fds[2];
+  if (pipe(fds) != 0)
+  {
+    std::perror("pipe");
+    std::exit(1);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const pid_t pid = fork();
+  if (pid == 0)
+  {
+#if defined(__linux__) and defined(__x86_64__)
+    if (count)
+    {
+      ptrace(PTRACE_TRACEME, 0, 0, 0);
+      std::raise(SIGSTOP); // wait for count_syscalls()
+    }
+#endif
+    const size_t nb_dirs = search(dir);
+    const bool written = \
+      write(fds[1], &nb_dirs, sizeof(nb_dirs)) == sizeof(nb_dirs);
+    _exit(written ? 0 : 1);
+  }
+  close(fds[1]);
+  rusage usage;
+  if (count)
+  {
+    waitpid(pid, nullptr, 0); // stopped by SIGSTOP
+    count_syscalls(pid, measures.syscalls);
+  }
+  else
+  {
+    wait4(pid, nullptr, 0, &usage);
+    const std::chrono::duration<double> wall = \
+      std::chrono::steady_clock::now() - start;
+    measures.wall = wall.count();
+    measures.user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    measures.sys = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  }
+  if (read(fds[0], &measures.nb_dirs, sizeof(size_t)) != sizeof(size_t))
+    std::fprintf(stderr, "walk: the search of %s failed\n", dir.c_str());
+  close(fds[0]);
+  return measures;
+}
+
+/// Make the synthetic tree of 100^3 directories below 'dir'.
+static void create(const String& dir)
+{
+  mkdir(dir.c_str(), 0755);
+  for (int i = 0; i < 100; i++)
+  {
+    const String dir_i = dir + "/d" + std::to_string(i);
+    mkdir(dir_i.c_str(), 0755);
+    for (int j = 0; j < 100; j++)
+    {
+      const String dir_j = dir_i + "/d" + std::to_string(j);
+      mkdir(dir_j.c_str(), 0755);
+      for (int k = 0; k < 100; k++)
+        mkdir((dir_j + "/d" + std::to_string(k)).c_str(), 0755);
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bool make_tree = false, count = can_count;
+  String dir;
+  for (int i = 1; i < argc; i++)
+  {
+    const String arg = argv[i];
+    if (arg == "--create")
+      make_tree = true;
+    else if (arg == "--no-count")
+      count = false;
+    else if (!dir.empty()) // several directories
+    {
+      dir.clear();
+      break;
+    }
+    else
+      dir = arg;
+  }
+  if (dir.empty())
+  {
+    std::fprintf(stderr, "Usage: walk [--create] [--no-count] DIR\n");
+    return 1;
+  }
+  if (make_tree)
+    create(dir);
+
+  std::printf("%-8s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "search", \
+      "dirs", "wall (s)", "user (s)", "sys (s)", "syscalls", "open", \
+      "getdents", "stat", "close");
+  const std::pair<const char*, size_t (*)(const String&)> searches[] = \
+    {{"readdir", readdir_search}, {"walk", walk_search}};
+  for (const auto& search : searches)
+  {
+    Measures measures = measure(search.second, dir, false);
+    if (count)
+      std::copy_n(measure(search.second, dir, true).syscalls, nb_syscalls, \
+          measures.syscalls);
+    std::printf("%-8s %9zu %9.2f %9.2f %9.2f", search.first, \
+        measures.nb_dirs, measures.wall, measures.user, measures.sys);
+    for (const long n : measures.syscalls)
+      if (count)
+        std::printf(" %9ld", n);
+      else
+        std::printf(" %9s", "-");
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+  return 0;
+}
@@ -1,15 +1,147 @@
+#include <chrono>
+#include <cstdio> // std::fopen, std::fread, std::fwrite
+#include <cstring> // std::memchr, std::strcspn
 #include <iostream>
+#include <stdexcept> // std::out_of_range
+#include <string>
 
 #include "../../include/eval/eval_error.hh"
 #include "../../include/eval/lexer.hh"
 #include "../../include/eval/operator.hh"
 #include "../../include/eval/parser.hh"
 
+/// Size of the input and output buffers of the batch mode.
+static const size_t buffer_size = 1 << 16;
+
+/**
+ * Batch mode: evaluate the expressions read from a file, one per line, with
+ * a single parser, and write their results on the standard output, one per
+ * line. If an expression cannot be evaluated, its line is the (first line
+ * of the) error message instead, and the next expressions are evaluated.
+ * Both the input and the output are read and written by blocks.
+ * If 'bench' is set, the throughput is printed on the standard error.
+ * Return the code of the first error (see EvalException::Code), if any.
+ * Throw an EvalException::BadFile exception if reading the file fails.
+ */
+static int batch(std::FILE* file, bool bench)
+{
+  const auto start = std::chrono::steady_clock::now();
+  Parser parser;
+  std::string input(buffer_size, '\0'), line, output;
+  output.reserve(buffer_size + 64);
+  size_t nb_expressions = 0, nb_errors = 0;
+  int code = EvalException::SUCCESS;
+
+  auto error = [&](const char* what, int error_code)
+  {
+    output.append(what, std::strcspn(what, "\n"));
+    if (nb_errors++ == 0)
+      code = error_code;
+  };
+  auto evaluate_line = [&]()
+  {
+    try
+    {
+      char result[24];
+      output.append(result, \
+          std::snprintf(result, sizeof(result), "%ld", parser.eval(line)));
+    }
+    catch(const EvalException::BaseException& e)
+    {
+      error(e.what(), e.code());
+    }
+    catch(const std::out_of_range&) // a number which is not a long
+    {
+      error("[ERROR 3] Number out of range", \
+          EvalException::ARITHMETIC_ERROR);
+    }
+    output += '\n';
+    nb_expressions++;
+    if (output.size() >= buffer_size)
+    {
+      std::fwrite(output.data(), 1, output.size(), stdout);
+      output.clear();
+    }
+  };
+
+  /* Split every block read into lines; the last one may be continued. */
+  size_t size;
+  while ((size = std::fread(&input[0], 1, input.size(), file)) > 0)
+  {
+    const char* begin = input.data();
+    const char* end = begin + size;
+    const char* eol;
+    while ((eol = static_cast<const char*>( \
+            std::memchr(begin, '\n', end - begin))) != nullptr)
+    {
+      line.append(begin, eol);
+      evaluate_line();
+      line.clear();
+      begin = eol + 1;
+    }
+    line.append(begin, end);
+  }
+  if (!line.empty()) // no newline at the end of the file
+    evaluate_line();
+  std::fwrite(output.data(), 1, output.size(), stdout);
+  std::fflush(stdout);
+  if (std::ferror(file))
+    throw EvalException::BadFile();
+
+  if (bench)
+  {
+    const std::chrono::duration<double> time = \
+      std::chrono::steady_clock::now() - start;
+    std::fprintf(stderr, "%zu expressions (%zu errors) in %.3f s:" \
+        " %.0f expressions/s\n", nb_expressions, nb_errors, time.count(), \
+        time.count() > 0 ? nb_expressions / time.count() : 0.);
+  }
+  return code;
+}
+
 int main(int argc, char** argv)
 {
   try
   {
-    if (argc != 2)
+    if (argc >= 2 and std::string(argv[1]) == "--batch")
+    {
+      /* Parse the options of the batch mode, and the file (at most one). */
+      bool bench = false;
+      const char* path = nullptr;
+      for (int i = 2; i < argc; i++)
+      {
+        if (std::string(argv[i]) == "--bench")
+        {
+          if (bench) // given twice
+            throw EvalException::BadArgument();
+          bench = true;
+        }
+        else if (!path)
+          path = argv[i];
+        else
+          throw EvalException::BadArgument();
+      }
+
+      const bool standard_input = !path or std::string(path) == "-";
+      std::FILE* file = standard_input ? stdin : std::fopen(path, "rb");
+      if (!file)
+        throw EvalException::BadFile();
+      int code;
+      try
+      {
+        code = batch(file, bench);
+      }
+      catch(...)
+      {
+        if (!standard_input)
+          std::fclose(file);
+        throw;
+      }
+      if (!standard_input)
+        std::fclose(file);
+      return code;
+    }
+    else if (argc != 2)
       throw EvalException::BadArgument();
     else
       std::cout << Parser(argv[1]).eval() << "\n";
@@ -15,7 +15,18 @@ namespace EvalException
   }
   const char* BadArgument::what() const throw()
   {
-    return "[ERROR 4] Bad number of arguments. Usage: ./eval <expression>";
+    return "[ERROR 4] Bad number of arguments. Usage: ./eval <expression>" \
+      " or ./eval --batch [--bench] [FILE]";
+  }
+
+  /* BadFile */
+  Code BadFile::code() const
+  {
+    return BAD_ARGUMENT;
+  }
+  const char* BadFile::what() const throw()
+  {
+    return "[ERROR 4] Cannot read the file of expressions";
   }
 
   /* BadImplementation */
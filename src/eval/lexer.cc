@@ -4,16 +4,13 @@
 #include "../../include/eval/lexer.hh"
 #include "../../include/eval/operator.hh"
 
-Lexer::Lexer(std::string expression)
-  : expression_(expression), pos_(0)
+Lexer::Lexer(const std::string& expression)
+  : pos_(0)
 {
   if (!is_valid_operator_implementation())
     throw EvalException::BadOperatorImplementation();
 
-  remove_whitespaces();
-
-  if (!is_valid_expression())
-    throw EvalException::LexerError();
+  read(expression);
 }
 
 std::string Lexer::consume_number() const
@@ -130,23 +127,28 @@ Operator Lexer::next_token() const
     return Operator(consume_operator());
 }
 
+void Lexer::read(const std::string& expression)
+{
+  expression_.assign(expression); // no allocation if it fits
+  rewind();
+
+  remove_whitespaces();
+
+  if (!is_valid_expression())
+    throw EvalException::LexerError();
+}
+
+void Lexer::rewind() const
+{
+  pos_ = 0;
+}
+
 void Lexer::remove_whitespaces()
 {
-  /* Naive implementation. */
-  std::string old = expression_;
-  expression_ .clear();
-  for (const auto& c : old)
+  /* Move the other characters to the front, without any copy. */
+  size_t size = 0;
+  for (const auto& c : expression_)
    if (c != ' ' and c != '\n' and c != '\r' and c != '\t')
-     expression_ += c;
-
-#if 0
-  /*
-   * Less naive implementation:
-   * https://www.gamedev.net/forums/topic/359650-remove-whitespace-from-string/
-   */
-#include <algorithm>
-  expression_.erase(\
-      remove_if(expression_.begin(), expression_.end(), ::isspace), \
-      expression_.end());
-#endif
+     expression_[size++] = c;
+  expression_.resize(size);
 }
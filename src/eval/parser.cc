@@ -3,33 +3,100 @@
 #include "../../include/eval/operator.hh"
 #include "../../include/eval/parser.hh"
 
-Parser::Parser(std::string expression)
+Parser::Parser(const std::string& expression)
   : lexer_(Lexer(expression))
 {}
 
 AST Parser::ast() const
 {
-  std::stack<Operator> O;
-  std::stack<AST> A;
+  const Lexer lexer = lexer_; // so that lexer_ is not rewound
+  OperatorStack operators;
+  TreeBuilder<Operator> asts; // stack of ASTs
+  AST ast;
+  shunting_yard(lexer, operators, asts);
+  asts.build(ast); // an empty AST if there are no subtrees
+  return ast;
+}
+
+Program Parser::compile() const
+{
+  Program program;
+  compile(program);
+  return program;
+}
+
+void Parser::compile(Program& program) const
+{
+  const Lexer lexer = lexer_; // so that lexer_ is not rewound
+  OperatorStack operators;
+  shunting_yard(lexer, operators, program);
+}
+
+long Parser::eval() const
+{
+  return compile().run();
+}
+
+long Parser::eval(const std::string& expression)
+{
+  lexer_.read(expression);
+  shunting_yard(lexer_, operators_, program_);
+  return program_.run();
+}
+
+template <typename Builder>
+void Parser::pop_operator_and_add_node(OperatorStack& O, Builder& A) const
+{
+  /* Pop an operator from the operator stack. */
+  if (O.empty())
+    throw EvalException::ParserError();
+  Operator o = O.top();
+  O.pop();
+
+  /* This operator must be neither a parenthesis, nor a number, nor STOP. */
+  if (!o.is_operator())
+    throw EvalException::ParserError();
+
+  /* Give the operator to the builder, which takes the last r items pushed
+   * as its operands (e.g., as its children ASTs). */
+  unsigned r = o.arity();
+  if (A.nb_subtrees() < r)
+    throw EvalException::ParserError();
+
+  if (r == 1 or r == 2)
+    A.push_node(o, r); // the last r items become the operands of o
+
+  else // by design, operators with arity > 2 are not supported
+    throw EvalException::BadOperatorImplementation();
+}
+
+template <typename Builder>
+void Parser::shunting_yard(const Lexer& lexer, OperatorStack& O, \
+    Builder& A) const
+{
+  while (!O.empty())
+    O.pop();
+  A.clear();
+  lexer.rewind();
 
   /* Read the whole expression. */
   while (true)
   {
     /*
      * Tricky!
-     * The snippet Operator o1; o1 = lexer_.next_token(); does not compile.
+     * The snippet Operator o1; o1 = lexer.next_token(); does not compile.
      * The value returned by a method can only be used as a rhs in a
      * definition, but not in a later assignment, so this o1 cannot be
      * modified either. And so, I could see no other way to write this loop.
      */
-    const auto o1 = lexer_.next_token();
+    const auto o1 = lexer.next_token();
     if (o1.is_stop())
       break;
 
     /* Two easy cases. */
     if (o1.is_number())
     {
-      A.push({o1}); // {o1}: construct an AST with a single node o1
+      A.push_leaf(o1); // e.g., push an AST with a single node o1
       continue;
     }
     if (o1.is_left_parenthesis())
@@ -76,104 +143,7 @@ AST Parser::ast() const
   while (!O.empty())
     pop_operator_and_add_node(O, A);
 
-  /* Get the result. */
-  if (A.empty())
-    return {};
-  if (A.size() != 1)
-    throw EvalException::ParserError();
-  return A.top();
-}
-
-long Parser::eval() const
-{
-  const auto RPN = ast().post_order_search(); // RPN is a vector of Operator*s
-
-  /* Trivial case. */
-  if (RPN.empty())
-    return 0;
-
-  /**
-   * Read the RPN vector from left to right, and evluate on-the-fly
-   * using a stack to store temporary results.
-   */
-  std::stack<long> numbers;
-  for (const auto& ptr : RPN)
-  {
-    const auto& o = *ptr;
-    {
-      if (o.is_number())
-      {
-        numbers.push(o.eval());
-        continue;
-      }
-
-      unsigned r = o.arity();
-      if (numbers.size() < r)
-        throw EvalException::ParserError();
-
-      if (r == 1)
-      {
-        long first = numbers.top();
-        numbers.pop();
-        numbers.push(o.eval(first));
-      }
-
-      else if (r == 2)
-      {
-        long second = numbers.top();
-        numbers.pop();
-        long first = numbers.top();
-        numbers.pop();
-        numbers.push(o.eval(first, second));
-      }
-
-      else // should not occur, since our AST is a valid BinaryTree
-        throw EvalException::BadOperatorImplementation();
-    }
-  }
-  /* Get the result. */
-  if (numbers.size() != 1) // should not occur, since our AST is valid
-    throw EvalException::ParserError();
-  return numbers.top();
-}
-
-void Parser::pop_operator_and_add_node(\
-    std::stack<Operator>& O, std::stack<AST>& A) const
-{
-  /* Pop an operator from the operator stack. */
-  if (O.empty())
-    throw EvalException::ParserError();
-  Operator o = O.top();
-  O.pop();
-
-  /* This operator must be neither a parenthesis, nor a number, nor STOP. */
-  if (!o.is_operator())
-    throw EvalException::ParserError();
-
-  /* Collect the children ASTs from the AST stack, and combine them with the
-   * operator to push a new AST to the AST stack. */
-  std::vector<AST> children;
-
-  unsigned r = o.arity();
-  if (A.size() < r)
+  /* There must be at most one result left. */
+  if (A.nb_subtrees() > 1)
     throw EvalException::ParserError();
-
-  if (r == 1)
-  {
-    AST right = A.top();
-    A.pop();
-    A.push(AST(o, right));
-  }
-
-  else if (r == 2)
-  {
-    AST right = A.top();
-    A.pop();
-    AST left = A.top();
-    A.pop();
-    A.push(AST(o, left, right));
-  }
-
-  else // by design, operators with arity > 2 are not supported
-    throw EvalException::BadOperatorImplementation();
 }
@@ -0,0 +1,150 @@
+#include <math.h> // pow
+
+#include "../../include/eval/eval_error.hh"
+#include "../../include/eval/operator.hh"
+#include "../../include/eval/program.hh"
+
+void Program::clear()
+{
+  code_.clear();
+  literals_.clear();
+  nb_values_ = 0;
+  max_nb_values_ = 0;
+}
+
+bool Program::empty() const
+{
+  return code_.empty();
+}
+
+size_t Program::nb_subtrees() const
+{
+  return nb_values_;
+}
+
+void Program::push_leaf(const Operator& number)
+{
+  literals_.push_back(number.eval()); // decoded once and for all
+  code_.push_back(PUSH);
+  if (++nb_values_ > max_nb_values_)
+    max_nb_values_ = nb_values_;
+}
+
+void Program::push_node(const Operator& o, size_t arity)
+{
+  if (arity != o.arity() or nb_values_ < arity)
+    throw EvalException::BadOperatorArguments();
+
+  switch (o.type_)
+  {
+    case (Operator::UNARY_PLUS):
+      return; // nothing to do
+
+    case (Operator::UNARY_MINUS):
+      code_.push_back(NEGATE);
+      return;
+
+    case (Operator::BINARY_PLUS):
+      code_.push_back(ADD);
+      break;
+
+    case (Operator::BINARY_MINUS):
+      code_.push_back(SUBTRACT);
+      break;
+
+    case (Operator::TIMES):
+      code_.push_back(MULTIPLY);
+      break;
+
+    case (Operator::DIVIDE):
+      code_.push_back(DIVIDE);
+      break;
+
+    case (Operator::REMAINDER):
+      code_.push_back(REMAINDER);
+      break;
+
+    case (Operator::POWER):
+      code_.push_back(POWER);
+      break;
+
+    default: // not an arithmetic operator
+      throw EvalException::BadOperatorArguments();
+  }
+  nb_values_--; // two values popped, one pushed
+}
+
+long Program::run() const
+{
+  if (code_.empty())
+    return 0;
+
+  /*
+   * The stack of values: an array on the call stack, unless the expression
+   * is too deeply nested. Its size is known, and every instruction has been
+   * checked to find its operands during the compilation, so neither the
+   * size of the stack nor the number of values is checked here.
+   */
+  long fixed_stack[fixed_stack_size];
+  std::vector<long> large_stack;
+  long* stack = fixed_stack;
+  if (max_nb_values_ > fixed_stack_size)
+  {
+    large_stack.resize(max_nb_values_);
+    stack = large_stack.data();
+  }
+
+  /* The values are stack[0], ..., sp[-1]. */
+  long* sp = stack;
+  const long* literal = literals_.data();
+  for (const auto opcode : code_)
+  {
+    switch (opcode)
+    {
+      case (PUSH):
+        *sp++ = *literal++;
+        break;
+
+      case (NEGATE):
+        sp[-1] = -sp[-1];
+        break;
+
+      case (ADD):
+        sp--;
+        sp[-1] += *sp;
+        break;
+
+      case (SUBTRACT):
+        sp--;
+        sp[-1] -= *sp;
+        break;
+
+      case (MULTIPLY):
+        sp--;
+        sp[-1] *= *sp;
+        break;
+
+      case (DIVIDE):
+        sp--;
+        if (*sp == 0)
+          throw EvalException::DivisionByZero();
+        sp[-1] /= *sp;
+        break;
+
+      case (REMAINDER):
+        sp--;
+        if (*sp == 0)
+          throw EvalException::DivisionByZero();
+        sp[-1] %= *sp;
+        break;
+
+      case (POWER): // same as Operator::eval()
+        sp--;
+        if (sp[-1] == 0 and *sp < 0)
+          throw EvalException::DivisionByZero();
+        sp[-1] = static_cast<long>(pow(sp[-1], *sp));
+        break;
+    }
+  }
+  return stack[0];
+}
@@ -0,0 +1,192 @@
+#include <cstring> // std::memcmp, std::strlen
+#include <string>
+
+#include "../../include/rd/glob.hh"
+
+Glob::Glob(const std::vector<std::string>& patterns)
+{
+  /*
+   * Split the patterns into alternatives (an escaped '|', or a '|' in a set,
+   * is literal).
+   */
+  for (const auto& pattern : patterns)
+  {
+    size_t begin = 0;
+    for (size_t pos = 0; pos <= pattern.size(); pos++)
+    {
+      size_t end;
+      if (pos < pattern.size() and pattern[pos] == '\\')
+        pos++;
+      else if (pos < pattern.size() and pattern[pos] == '[' \
+          and (end = set_end(pattern, pos)) != std::string::npos)
+        pos = end;
+      else if (pos == pattern.size() or pattern[pos] == '|')
+      {
+        alternatives_.push_back(compile(pattern.substr(begin, pos - begin)));
+        begin = pos + 1;
+      }
+    }
+  }
+}
+
+Glob::Alternative Glob::compile(const std::string& pattern)
+{
+  std::vector<Token> tokens;
+  auto literal = [&tokens](char c)
+  {
+    if (tokens.empty() or tokens.back().kind != Token::LITERAL)
+      tokens.push_back({Token::LITERAL, "", {}});
+    tokens.back().literal += c;
+  };
+
+  for (size_t pos = 0; pos < pattern.size(); pos++)
+  {
+    const char c = pattern[pos];
+    if (c == '*')
+    {
+      if (tokens.empty() or tokens.back().kind != Token::STAR) // "**" = "*"
+        tokens.push_back({Token::STAR, "", {}});
+    }
+    else if (c == '?')
+      tokens.push_back({Token::ANY, "", {}});
+    else if (c == '\\' and pos + 1 < pattern.size())
+      literal(pattern[++pos]);
+    else if (c == '[')
+    {
+      /* A set (see set_end()); without a closing bracket, '[' is literal. */
+      const size_t end = set_end(pattern, pos);
+      if (end == std::string::npos)
+      {
+        literal(c);
+        continue;
+      }
+      const bool negated = pattern[pos + 1] == '!' or pattern[pos + 1] == '^';
+
+      /* Read a byte of the set at k (escaped or not), and move k after it. */
+      auto byte = [&pattern](size_t& k)
+      {
+        if (pattern[k] == '\\') // never right before the closing bracket
+          k++;
+        return static_cast<unsigned char>(pattern[k++]);
+      };
+      Token token{Token::SET, "", {}};
+      for (size_t k = pos + 1 + negated; k < end; )
+      {
+        unsigned char low = byte(k), high = low;
+        if (k + 1 < end and pattern[k] == '-') // a range
+        {
+          k++;
+          high = byte(k);
+        }
+        for (unsigned b = low; b <= high; b++)
+          token.set.set(b);
+      }
+      if (negated)
+        token.set.flip();
+      tokens.push_back(token);
+      pos = end;
+    }
+    else
+      literal(c);
+  }
+
+  Alternative alternative{tokens, tokens.size(), 0};
+  while (alternative.tail > 0 \
+      and tokens[alternative.tail - 1].kind != Token::STAR)
+  {
+    const Token& token = tokens[--alternative.tail];
+    alternative.tail_size += \
+      (token.kind == Token::LITERAL) ? token.literal.size() : 1;
+  }
+  return alternative;
+}
+
+size_t Glob::set_end(const std::string& pattern, size_t pos)
+{
+  size_t end = pos + 1;
+  if (end < pattern.size() and (pattern[end] == '!' or pattern[end] == '^'))
+    end++;
+  if (end < pattern.size() and pattern[end] == ']')
+    end++;
+  for (; end < pattern.size() and pattern[end] != ']'; end++)
+    if (pattern[end] == '\\')
+      end++;
+  return end < pattern.size() ? end : std::string::npos;
+}
+
+bool Glob::empty() const
+{
+  return alternatives_.empty();
+}
+
+bool Glob::match(const char* name) const
+{
+  for (const auto& alternative : alternatives_)
+    if (match(alternative, name))
+      return true;
+  return false;
+}
+
+bool Glob::match(const Alternative& alternative, const char* name)
+{
+  const auto& tokens = alternative.tokens;
+
+  /* Match the tail at the end of the name (the whole name without star). */
+  const size_t size = std::strlen(name);
+  if (size < alternative.tail_size \
+      or (alternative.tail == 0 and size != alternative.tail_size))
+    return false;
+  const char* const end = name + size - alternative.tail_size;
+  const char* s = end;
+  for (size_t t = alternative.tail; t < tokens.size(); t++)
+    if (!match(tokens[t], s, name + size))
+      return false;
+
+  /*
+   * Match the head, which ends with a star, before the tail. Greedy
+   * matching only backtracks to the last star: the star then matches one
+   * more byte. Every other token has a fixed length, so this is enough,
+   * and takes O(length of the name x length of the pattern) time at worst.
+   */
+  const size_t nb_tokens = alternative.tail, none = nb_tokens + 1;
+  size_t t = 0, star = none;
+  const char* star_s = nullptr;
+  s = name;
+  while (t < nb_tokens)
+  {
+    if (tokens[t].kind == Token::STAR)
+    {
+      star = ++t;
+      star_s = s;
+    }
+    else if (match(tokens[t], s, end))
+      t++;
+    else if (star == none or star_s == end)
+      return false;
+    else
+    {
+      /* Mismatch: let the last star match one more byte. */
+      t = star;
+      s = ++star_s;
+    }
+  }
+  return true;
+}
+
+bool Glob::match(const Token& token, const char*& s, const char* end)
+{
+  if (token.kind == Token::LITERAL)
+  {
+    const size_t size = token.literal.size();
+    if (static_cast<size_t>(end - s) < size \
+        or std::memcmp(s, token.literal.data(), size) != 0)
+      return false;
+    s += size;
+    return true;
+  }
+  if (s == end or (token.kind == Token::SET \
+      and !token.set.test(static_cast<unsigned char>(*s))))
+    return false;
+  s++;
+  return true;
+}
@@ -1,26 +1,215 @@
 #include <iostream>
+#include <string>
 #include <system_error> // std::error_condition
+#ifdef __linux__
+#include <unistd.h> // STDIN_FILENO
+#endif
 
 #include "../../include/rd/reader.hh"
+#include "../../include/rd/watcher.hh"
+#include "../../include/tree/mapped_tree.hh"
+
+/// Print the usage on stderr, and return the corresponding exit code.
+static int usage()
+{
+  std::cerr << "Usage: ./rd [-a] [--files] [-j N] [-L N] [--prune PATTERN]" \
+    " [--exclude PATTERN] [--stream] [--cache FILE] [--watch] [--du]" \
+    " [--format text|jsonl|ndjson|bin] [--sort name|mtime|size]" \
+    " [--save FILE] <path>" << std::endl \
+    << "       ./rd --load FILE" << std::endl;
+  return 2;
+}
+
+/**
+ * Parse a positive number (e.g., a number of threads) into n.
+ * Return false if the string is not a positive number.
+ */
+static bool parse_positive(const String& s, size_t& n)
+{
+  if (s.empty() or s.size() > 6 \
+      or s.find_first_not_of("0123456789") != String::npos)
+    return false;
+  n = std::stoul(s);
+  return n > 0;
+}
+
+/**
+ * If argv[i] is the long option with the given name (e.g., "--cache"),
+ * given as "--name VALUE" or "--name=VALUE", store its value (possibly
+ * empty), move i to its last argument, and return true.
+ */
+static bool parse_option(const String& name, int argc, char* argv[], int& i, \
+    String& value)
+{
+  const String arg = argv[i];
+  if (arg.compare(0, name.size(), name) != 0)
+    return false;
+  value.clear();
+  if (arg.size() > name.size() and arg[name.size()] == '=')
+    value = arg.substr(name.size() + 1);
+  else if (arg.size() == name.size() and i + 1 < argc)
+    value = argv[++i];
+  else if (arg.size() > name.size()) // another option, e.g. "--cachex"
+    return false;
+  return true;
+}
 
 int main(int argc, char* argv[])
 {
-  if (argc > 2)
+  /* Parse the options, and the path (at most one). */
+  ReaderOptions options;
+  String path = ".";
+  bool has_path = false;
+  bool options_ended = false; // after "--", everything is a path
+#ifdef __linux__
+  bool watch = false;
+#endif
+  String snapshot; // the file to load, if any
+  String value;
+  for (int i = 1; i < argc; i++)
+  {
+    const String arg = argv[i];
+    if (!options_ended and arg == "--")
+      options_ended = true;
+    else if (!options_ended and arg.compare(0, 2, "-j") == 0)
+    {
+      value = arg.substr(2); // -jN
+      if (value.empty() and i + 1 < argc) // -j N
+        value = argv[++i];
+      if (!parse_positive(value, options.nb_threads))
+        return usage();
+    }
+    else if (!options_ended and arg.compare(0, 2, "-L") == 0)
+    {
+      value = arg.substr(2); // -LN
+      if (value.empty() and i + 1 < argc) // -L N
+        value = argv[++i];
+      if (!parse_positive(value, options.max_depth))
+        return usage();
+    }
+    else if (!options_ended and parse_option("--prune", argc, argv, i, value))
+    {
+      if (value.empty())
+        return usage();
+      options.prune.push_back(value);
+    }
+    else if (!options_ended \
+        and parse_option("--exclude", argc, argv, i, value))
+    {
+      if (value.empty())
+        return usage();
+      options.exclude.push_back(value);
+    }
+    else if (!options_ended \
+        and parse_option("--format", argc, argv, i, value))
+    {
+      if (value == "text")
+        options.format = OutputFormat::text;
+      else if (value == "jsonl" or value == "ndjson")
+        options.format = OutputFormat::jsonl;
+      else if (value == "bin")
+        options.format = OutputFormat::bin;
+      else
+        return usage();
+    }
+    else if (!options_ended and parse_option("--sort", argc, argv, i, value))
+    {
+      if (value == "name")
+        options.sort = SortOrder::name;
+      else if (value == "mtime")
+        options.sort = SortOrder::mtime;
+      else if (value == "size")
+        options.sort = SortOrder::size;
+      else
+        return usage();
+    }
+    else if (!options_ended and arg == "--stream")
+      options.stream = true;
+    else if (!options_ended and arg == "--files")
+      options.files = true;
+    else if (!options_ended and arg == "-a")
+      options.files = options.hidden = true;
+#ifdef __linux__
+    else if (!options_ended and arg == "--watch")
+      watch = true;
+    else if (!options_ended and arg == "--du")
+      options.du = true;
+#endif
+    else if (!options_ended and parse_option("--cache", argc, argv, i, value))
+    {
+      if (value.empty())
+        return usage();
+      options.cache_file = value;
+    }
+    else if (!options_ended and parse_option("--save", argc, argv, i, value))
+    {
+      if (value.empty())
+        return usage();
+      options.snapshot_file = value;
+    }
+    else if (!options_ended and parse_option("--load", argc, argv, i, value))
+    {
+      if (value.empty())
+        return usage();
+      snapshot = value;
+    }
+    else if (!options_ended and arg.size() > 1 and arg[0] == '-')
+      return usage();
+    else if (has_path)
+      return usage();
+    else
+    {
+      path = arg;
+      has_path = true;
+    }
+  }
+
+  /*
+   * Print a saved tree: it is mapped, and printed as it is (the names are
+   * appended to the lines from the snapshot, without being copied).
+   */
+  if (!snapshot.empty())
   {
-    std::cerr << "Usage: ./rd <path>" << std::endl;
-    return 2;
+    try
+    {
+      MappedTree<String> tree(snapshot);
+      auto label = [](const char* name, String& line) { line += name; };
+      tree.print(std::cout, make_print_policy(label, label, label));
+      std::cout << "\n" << (tree.size() > 0 ? tree.size() - 1 : 0) \
+        << " directories" << std::endl;
+    }
+    catch (const std::exception& error) // std::system_error, or invalid file
+    {
+      std::cerr << "rd: " << error.what() << std::endl;
+      return 1;
+    }
+    return 0;
   }
 
-  const String path = (argc == 1) ? "." : argv[1];
   try
   {
-    std::cout << DirectoryReader(path).read_directory();
+#ifdef __linux__
+    if (watch)
+      DirectoryWatcher(path, options).run(std::cout, STDIN_FILENO);
+    else
+#endif
+    {
+      DirectoryReader reader(path, options);
+      reader.read_directory(std::cout);
+      if (reader.nb_errors() > 0) // the tree lacks some subdirectories
+        return 1;
+    }
   }
   catch(const std::error_condition& econd)
   {
     std::cerr << path + " [error opening dir]\n\n0 directories" << std::endl;
     return 1;
   }
+  catch(const std::system_error& error) // e.g., the cache cannot be written
+  {
+    std::cerr << "rd: " << error.what() << std::endl;
+    return 1;
+  }
 
   return 0;
 }
@@ -1,32 +1,533 @@
+#include <algorithm> // std::copy, std::remove_if, std::sort, std::stable_sort
+#include <atomic>
 #include <cerrno>
+#include <cstdint> // uint64_t, int64_t
+#include <cstring> // std::strcmp, std::strlen
+#include <ctime> // std::time
 #include <dirent.h>
 #include <functional> // std::function
+#include <iostream> // std::cerr
+#include <sstream> // std::ostringstream
 #include <stack>
 #include <system_error>
+#include <sys/stat.h> // lstat, fstat, fstatat, statx
+#ifdef __linux__
+#include <cmath> // std::ceil
+#include <cstdio> // std::snprintf
+#include <deque>
+#include <memory> // std::unique_ptr
+#include <mutex>
+#include <set>
+#include <fcntl.h> // open, openat
+#include <sys/syscall.h> // SYS_getdents64
+#include <sys/sysmacros.h> // makedev
+#include <unistd.h> // close, syscall
+#endif
 
 #include "../../include/rd/reader.hh"
+#include "../../include/rd/scan_cache.hh"
+#include "../../include/tree/mapped_tree.hh"
+#include "../../include/tree/thread_pool.hh"
 #include "../../include/tree/tree.hh"
+#include "../../include/tree/tree_builder.hh"
 
-DirectoryReader::DirectoryReader(const Path& path)
-  : path_(path)
+#ifdef __linux__
+/**
+ * Maximal number of pending batches of statx() calls (see disk_usage()),
+ * each of which holds a file descriptor.
+ */
+static const size_t max_pending_batches = 256;
+
+/**
+ * Maximal number of directories on the current path of walk() which keep
+ * their file descriptor open; those of the upper ones are closed, and
+ * opened again when the search goes back to them.
+ */
+static const size_t max_open_frames = 64;
+#endif
+
+/// Type of an entry (a DT_* constant of <dirent.h>), from its mode.
+static unsigned char entry_type(mode_t mode)
+{
+  return S_ISDIR(mode) ? DT_DIR : S_ISREG(mode) ? DT_REG : \
+    S_ISLNK(mode) ? DT_LNK : S_ISFIFO(mode) ? DT_FIFO : \
+    S_ISSOCK(mode) ? DT_SOCK : S_ISCHR(mode) ? DT_CHR : \
+    S_ISBLK(mode) ? DT_BLK : DT_UNKNOWN;
+}
+
+/**
+ * A subdirectory to sort (see ReaderOptions::sort): its name, its key for
+ * the orders other than by name, and its index in the range to sort.
+ */
+struct SortItem
+{
+  const char* name;
+  int64_t key;
+  size_t index;
+};
+
+/// Key of a directory for the orders other than by name, from its status.
+static int64_t sort_key(const struct stat& st, SortOrder order)
+{
+  if (order == SortOrder::size)
+    return -static_cast<int64_t>(st.st_size);
+  return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 \
+    + st.st_mtim.tv_nsec;
+}
+
+/**
+ * Sort items by name in byte-wise order (as std::strcmp(), so the order
+ * does not depend on the locale), from their byte at the given depth on,
+ * with a most-significant-digit radix sort: the items are distributed into
+ * 256 buckets by this byte (the names ending there coming first, as they
+ * are equal), through a scratch buffer of the same size, and every bucket
+ * is then sorted on the next byte. Small ranges are sorted by insertion.
+ * The names are only read sequentially, and never compared from their
+ * first byte again.
+ */
+static void radix_sort(SortItem* items, size_t n, size_t depth, \
+    SortItem* scratch)
+{
+  if (n < 32)
+  {
+    for (size_t i = 1; i < n; i++)
+    {
+      const SortItem item = items[i];
+      size_t j = i;
+      for (; j > 0 and std::strcmp(items[j - 1].name + depth, \
+            item.name + depth) > 0; j--)
+        items[j] = items[j - 1];
+      items[j] = item;
+    }
+    return;
+  }
+
+  size_t offsets[257] = {0};
+  for (size_t i = 0; i < n; i++)
+    offsets[static_cast<unsigned char>(items[i].name[depth]) + 1]++;
+  for (size_t b = 1; b < 257; b++)
+    offsets[b] += offsets[b - 1];
+  size_t next[256];
+  std::copy(offsets, offsets + 256, next);
+  for (size_t i = 0; i < n; i++)
+    scratch[next[static_cast<unsigned char>(items[i].name[depth])]++] \
+      = items[i];
+  std::copy(scratch, scratch + n, items);
+  for (size_t b = 1; b < 256; b++)
+    if (offsets[b + 1] - offsets[b] > 1)
+      radix_sort(items + offsets[b], offsets[b + 1] - offsets[b], \
+          depth + 1, scratch);
+}
+
+/**
+ * Sort items w.r.t. an order (other than SortOrder::none): by name, and
+ * then, for the other orders, by key with a stable sort, so that ties are
+ * sorted by name.
+ */
+static void sort_items(std::vector<SortItem>& items, SortOrder order, \
+    std::vector<SortItem>& scratch)
+{
+  scratch.resize(items.size());
+  radix_sort(items.data(), items.size(), 0, scratch.data());
+  if (order != SortOrder::name)
+    std::stable_sort(items.begin(), items.end(), \
+        [](const SortItem& a, const SortItem& b) { return a.key < b.key; });
+}
+
+DirectoryReader::DirectoryReader(const Path& path, \
+    const ReaderOptions& options)
+  : path_(path), options_(options), prune_(options.prune), \
+    exclude_(options.exclude), nb_skipped_(0), nb_files_(0), \
+    nb_errors_(0)
 {}
 
-DirectoryReader::DirectoryReader(const String& string)
-  : path_(string.c_str()) // .c_str(): convert a std::string to a char*
+DirectoryReader::DirectoryReader(const String& string, \
+    const ReaderOptions& options)
+  : path_(string.c_str()), options_(options), prune_(options.prune), \
+    exclude_(options.exclude), nb_skipped_(0), nb_files_(0), \
+    nb_errors_(0) // to a char*
 {}
 
-std::string DirectoryReader::read_directory() const
+#ifdef __linux__
+void DirectoryReader::disk_usage(std::ostream& os) const
 {
-  /* Read the directory table, and generate a tree from it. */
-  auto tree = Tree<String>(table());
+  /* Disk usage: allocated bytes, and number of inodes. */
+  struct Usage
+  {
+    uint64_t bytes = 0;
+    uint64_t inodes = 0;
+  };
+
+  /*
+   * Names of the directories, and usage of their own entries (including
+   * themselves, but not their subdirectories), indexed by pre-order ids,
+   * i.e., in the order of enter().
+   */
+  std::vector<String> names;
+  std::vector<Usage> own;
+
+  /*
+   * Usages of the entries stated by the tasks (see below), along with the
+   * ids of their directories. The folded directories (see below) share the
+   * id of their ancestor, so every task fills its own usage, which is only
+   * added to that of its directory once all tasks are done. A deque keeps
+   * every usage at the same address while it is filled by a task.
+   */
+  std::deque<std::pair<size_t, Usage>> task_usages;
+
+  /*
+   * The tree of the directory ids is built while walking; the directories
+   * on the current path are stacked. The subtree of a directory which is
+   * not expanded is folded into it: its subdirectories have its id, and
+   * are not nodes.
+   */
+  struct Dir
+  {
+    size_t id;
+    bool node;
+    bool expanded;
+  };
+  std::vector<Dir> path;
+
+  /*
+   * As with du, a file with several hard links is counted once: the first
+   * time one of its links is stated.
+   */
+  std::mutex links_mutex;
+  std::set<std::pair<uint64_t, uint64_t>> links;
 
-  /* Keep only the basename from a directory, e.g. replace a/b/c/d with d */
-  std::function<String(String)> keep_basenames_only = [](String s)
+  /* Add the usage of a directory and of its entries, given by their names. */
+  auto stat_entries = [&links_mutex, &links](int fd, const String& entries, \
+      Usage& usage)
   {
-    size_t idx = s.rfind("/");
-    return (idx == std::string::npos) ? s : s.substr(idx + 1);
+    const unsigned mask = STATX_TYPE | STATX_NLINK | STATX_INO | STATX_BLOCKS;
+    struct statx st;
+    if (statx(fd, "", AT_EMPTY_PATH, mask, &st) == 0)
+    {
+      usage.bytes += st.stx_blocks * 512;
+      usage.inodes++;
+    }
+    for (size_t pos = 0; pos < entries.size(); \
+        pos += std::strlen(&entries[pos]) + 1)
+    {
+      if (statx(fd, &entries[pos], AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, \
+          mask, &st) != 0)
+        continue;
+      if (st.stx_nlink > 1 and !S_ISDIR(st.stx_mode))
+      {
+        std::lock_guard<std::mutex> lock(links_mutex);
+        if (!links.insert({makedev(st.stx_dev_major, st.stx_dev_minor), \
+            st.stx_ino}).second)
+          continue;
+      }
+      usage.bytes += st.stx_blocks * 512;
+      usage.inodes++;
+    }
+  };
+
+  /*
+   * With several threads, the entries of every directory are stated by a
+   * task of the pool, with a duplicate of its file descriptor, while the
+   * search goes on. Too many pending tasks would hold too many file
+   * descriptors, so the search then states the entries itself.
+   */
+  std::unique_ptr<ThreadPool> pool;
+  if (options_.nb_threads > 1)
+    pool.reset(new ThreadPool(options_.nb_threads));
+  std::atomic<size_t> nb_pending(0);
+  auto visit = [&](int fd, String& entries)
+  {
+    const size_t id = path.back().id;
+    int task_fd = -1;
+    if (pool and nb_pending < max_pending_batches)
+      task_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (task_fd < 0)
+    {
+      stat_entries(fd, entries, own[id]);
+      return;
+    }
+    task_usages.push_back({id, Usage()});
+    Usage& usage = task_usages.back().second;
+    auto batch = std::make_shared<String>();
+    batch->swap(entries);
+    nb_pending++;
+    pool->submit([&stat_entries, &nb_pending, &usage, task_fd, batch]()
+        {
+          stat_entries(task_fd, *batch, usage);
+          close(task_fd);
+          nb_pending--;
+        });
+  };
+
+  TreeBuilder<size_t, InlineValues> builder;
+  walk([&](const char* name, size_t depth, bool, const EntryInfo&)
+      {
+        if (!path.empty() and !path.back().expanded)
+        {
+          path.push_back({path.back().id, false, false});
+          return;
+        }
+        const bool expanded = expands(name, depth);
+        if (!expanded)
+          nb_skipped_++;
+        path.push_back({names.size(), true, expanded});
+        names.emplace_back(name);
+        own.emplace_back();
+      }, \
+      [&](const char*, size_t nb_subdirs)
+      {
+        if (path.back().node)
+          builder.push_node(path.back().id, \
+              path.back().expanded ? nb_subdirs : 0);
+        path.pop_back();
+      }, visit);
+  if (pool)
+    pool->wait();
+  for (const auto& task_usage : task_usages)
+  {
+    own[task_usage.first].bytes += task_usage.second.bytes;
+    own[task_usage.first].inodes += task_usage.second.inodes;
+  }
+  auto tree = builder.build();
+
+  /* Sum the usages bottom-up. */
+  auto init = [&own](size_t id) { return own[id]; };
+  auto combine = [](Usage& sum, const Usage& child)
+  {
+    sum.bytes += child.bytes;
+    sum.inodes += child.inodes;
+  };
+  auto totals = pool ? \
+    tree.reduce_subtrees_parallel<Usage>(init, combine, *pool) : \
+    tree.reduce_subtrees<Usage>(init, combine);
+
+  /*
+   * Sorting by size is w.r.t. the disk usage (largest first, then by name):
+   * the tree is built again in this order, with the ids of the nodes of
+   * the first one as values (which are also those of the directories).
+   */
+  if (options_.sort == SortOrder::size)
+  {
+    std::vector<std::vector<size_t>> children(tree.size());
+    for (size_t id = 1; id < tree.size(); id++)
+      children[tree.parent(id)].push_back(id);
+    for (auto& ids : children)
+      std::sort(ids.begin(), ids.end(), [&](size_t a, size_t b)
+          {
+            return totals[a].bytes != totals[b].bytes ? \
+              totals[a].bytes > totals[b].bytes : names[a] < names[b];
+          });
+
+    TreeBuilder<size_t, InlineValues> sorted;
+    std::vector<std::pair<size_t, size_t>> stack(1, {0, 0}); // id, next
+    while (!stack.empty())
+    {
+      const size_t id = stack.back().first, k = stack.back().second++;
+      if (k < children[id].size())
+        stack.push_back({children[id][k], 0});
+      else
+      {
+        sorted.push_node(id, children[id].size());
+        stack.pop_back();
+      }
+    }
+    tree = sorted.build();
+  }
+
+  /* Human-readable size, rounded up as by du -h (e.g., 4.0K, 12M). */
+  auto human = [](uint64_t bytes)
+  {
+    if (bytes < 1024)
+      return std::to_string(bytes);
+    const char* units = "KMGTPE";
+    double size = bytes / 1024.;
+    for (; size >= 1024 and units[1]; units++)
+      size /= 1024;
+    char out[32];
+    if (std::ceil(size * 10) < 100)
+      std::snprintf(out, sizeof(out), "%.1f%c", std::ceil(size * 10) / 10, \
+          *units);
+    else
+      std::snprintf(out, sizeof(out), "%.0f%c", std::ceil(size), *units);
+    return String(out);
+  };
+
+  if (options_.format != OutputFormat::text)
+  {
+    RecordWriter writer(os, options_.format, true);
+    for (size_t id = 0; id < tree.size(); id++)
+    {
+      const size_t dir = tree.value(id);
+      writer.write(tree.parent(id), tree.node_depth(id), names[dir].c_str(), \
+          totals[dir].bytes, totals[dir].inodes);
+    }
+    writer.finish();
+    return;
+  }
+
+  /* TreePrintCompanion setup: every id is printed with its usage. */
+  std::function<String(size_t)> print_leaf = [&](size_t id)
+  {
+    return names[id] + " [" + human(totals[id].bytes) + ", " \
+      + std::to_string(totals[id].inodes) \
+      + (totals[id].inodes == 1 ? " inode]" : " inodes]");
+  };
+  TreePrintCompanion<size_t> pc(print_leaf, print_leaf, print_leaf);
+
+  tree.print(os, pc);
+  os << "\n" << tree.size() - 1 << " directories";
+  if (filters())
+    os << ", " << nb_skipped_ << " skipped";
+  os << ", " << totals[0].bytes << " bytes, " << totals[0].inodes \
+    << " inodes\n";
+}
+#endif
+
+bool DirectoryReader::expands(const char* name, size_t depth) const
+{
+  return (options_.max_depth == 0 or depth < options_.max_depth) \
+    and (depth == 0 or !prune_.match(name));
+}
+
+bool DirectoryReader::filters() const
+{
+  return options_.max_depth > 0 or !prune_.empty() or !exclude_.empty();
+}
+
+size_t DirectoryReader::nb_errors() const
+{
+  return nb_errors_;
+}
+
+size_t DirectoryReader::nb_files() const
+{
+  return nb_files_;
+}
+
+size_t DirectoryReader::nb_skipped() const
+{
+  return nb_skipped_;
+}
+
+bool DirectoryReader::parallel() const
+{
+  return options_.nb_threads > 1 and options_.cache_file.empty() \
+    and !options_.files and !options_.hidden;
+}
+
+Table<String> DirectoryReader::parallel_table() const
+{
+  /*
+   * A directory and its subdirectories, as read by a task. The vector of
+   * children is sized once, before the tasks reading them are submitted,
+   * so the addresses of the entries never change, and every task only
+   * writes its own entry.
+   */
+  struct Entry
+  {
+    Ptr<String> dir;
+    size_t depth;
+    int error; // errno if the directory cannot be opened, 0 otherwise
+    std::vector<Ptr<String>> subdirs;
+    std::vector<Entry> children;
+  };
+
+  /*
+   * The excluded subdirectories are dropped, and those which are not
+   * expanded have no task.
+   */
+  ThreadPool pool(options_.nb_threads);
+  std::atomic<size_t> nb_skipped(0);
+  std::function<void(Entry*)> read = [this, &pool, &nb_skipped, &read] \
+    (Entry* entry)
+  {
+    entry->subdirs = subdirectories(*entry->dir, &entry->error);
+    if (!exclude_.empty())
+    {
+      const size_t nb_subdirs = entry->subdirs.size();
+      entry->subdirs.erase(std::remove_if(entry->subdirs.begin(), \
+            entry->subdirs.end(), [this](const Ptr<String>& dir)
+            { return exclude_.match(dir->c_str() + dir->rfind('/') + 1); }), \
+          entry->subdirs.end());
+      nb_skipped += nb_subdirs - entry->subdirs.size();
+    }
+    sort_subdirectories(entry->subdirs);
+    entry->children.resize(entry->subdirs.size());
+    for (size_t k = 0; k < entry->subdirs.size(); k++)
+    {
+      Entry* child = &entry->children[k];
+      child->dir = entry->subdirs[k];
+      child->depth = entry->depth + 1;
+      if (expands(child->dir->c_str() + child->dir->rfind('/') + 1, \
+          child->depth))
+        pool.submit([&read, child]() { read(child); });
+      else
+        nb_skipped++;
+    }
   };
-  auto tree2 = tree.map(keep_basenames_only);
+
+  Entry root;
+  root.dir = std::make_shared<String>(String(path_));
+  root.depth = 0;
+  pool.submit([&read, &root]() { read(&root); });
+  pool.wait();
+  nb_skipped_ = nb_skipped;
+
+  /*
+   * Flatten the entries w.r.t. pre-order search, as in table(), and report
+   * the directories which could not be read as walk() does (in the same
+   * order).
+   */
+  std::stack<Entry*> s;
+  Table<String> out;
+  nb_errors_ = 0;
+  s.push(&root);
+  while (!s.empty())
+  {
+    Entry* entry = s.top();
+    s.pop();
+    if (entry->error != 0 and entry->error != EACCES \
+        and entry->error != ENOENT)
+      report(*entry->dir, entry->error);
+    out.push_back({entry->dir, std::move(entry->subdirs)});
+    for (auto rit = entry->children.rbegin(); \
+        rit != entry->children.rend(); rit++)
+      s.push(&*rit);
+  }
+  return out;
+}
+
+std::string DirectoryReader::read_directory() const
+{
+  std::ostringstream os;
+  read_directory(os);
+  return os.str();
+}
+
+void DirectoryReader::read_directory(std::ostream& os) const
+{
+#ifdef __linux__
+  if (options_.du)
+  {
+    disk_usage(os);
+    return;
+  }
+#endif
+  if (options_.format != OutputFormat::text)
+  {
+    records(os);
+    return;
+  }
+  if (options_.stream)
+  {
+    stream(os);
+    return;
+  }
+
+  /* Read the directory tree, and save it if needed. */
+  auto tree = this->tree();
+  if (!options_.snapshot_file.empty() and !options_.files)
+    MappedTree<String>::save(tree, options_.snapshot_file);
 
   /* TreePrintCompanion setup. */
   std::function<String(String)> print_leaf = [](String x) { return x; };
@@ -34,10 +535,128 @@ std::string DirectoryReader::read_directory() const
     print_root = [this](String x) { (void) x; return path_; };
   TreePrintCompanion<String> pc(print_leaf, print_leaf, print_root);
 
-  /* Generate the string to be pretty-printed. */
-  std::string s = tree2.to_string(pc) + "\n";
-  s += std::to_string(tree2.size() - 1) + " directories\n";
-  return s;
+  /* Pretty-print the tree. */
+  tree.print(os, pc);
+  os << "\n" << tree.size() - 1 - nb_files_ << " directories";
+  if (options_.files)
+    os << ", " << nb_files_ << " files";
+  if (filters())
+    os << ", " << nb_skipped_ << " skipped";
+  os << "\n";
+}
+
+void DirectoryReader::records(std::ostream& os) const
+{
+  RecordWriter writer(os, options_.format, false, options_.files);
+  if (parallel())
+  {
+    auto tree = this->tree();
+    writer.write(0, 0, path_);
+    for (size_t id = 1; id < tree.size(); id++)
+      writer.write(tree.parent(id), tree.node_depth(id), \
+          tree.value(id).c_str());
+  }
+  else
+  {
+    /* Ids of the directories on the current path. */
+    std::vector<size_t> path;
+    size_t nb_dirs = 0;
+    walk([&](const char* name, size_t depth, bool, const EntryInfo& info)
+        {
+          path.resize(depth);
+          writer.write(depth > 0 ? path.back() : 0, depth, name, 0, 0, \
+              info.type, info.ino);
+          path.push_back(nb_dirs++);
+        }, [](const char*, size_t) {});
+  }
+  writer.finish();
+}
+
+void DirectoryReader::report(const String& path, int error) const
+{
+  std::cerr << "rd: cannot read " << path << ": " << std::strerror(error) \
+    << std::endl;
+  nb_errors_++;
+}
+
+void DirectoryReader::sort_subdirectories( \
+    std::vector<Ptr<String>>& subdirs, std::vector<EntryInfo>* infos) const
+{
+  if (options_.sort == SortOrder::none or subdirs.size() < 2)
+    return;
+  std::vector<SortItem> items, scratch;
+  for (size_t k = 0; k < subdirs.size(); k++)
+  {
+    struct stat status;
+    items.push_back({subdirs[k]->c_str() + subdirs[k]->rfind('/') + 1, 0, k});
+    if (options_.sort != SortOrder::name \
+        and lstat(subdirs[k]->c_str(), &status) == 0)
+      items.back().key = sort_key(status, options_.sort);
+  }
+  sort_items(items, options_.sort, scratch);
+  std::vector<Ptr<String>> sorted;
+  std::vector<EntryInfo> sorted_infos;
+  for (const auto& item : items)
+  {
+    sorted.push_back(subdirs[item.index]);
+    if (infos)
+      sorted_infos.push_back((*infos)[item.index]);
+  }
+  subdirs.swap(sorted);
+  if (infos)
+    infos->swap(sorted_infos);
+}
+
+void DirectoryReader::stream(std::ostream& os) const
+{
+  /* Same pieces of lines as in Tree<T>::print(), with the default layout. */
+  TreePrintCompanion<String> pc;
+  std::string hline;
+  for (unsigned i = 0; i < pc.dashes(); i++)
+    hline += "\u2500"; // ─
+  std::string spaces(pc.spaces(), ' ');
+  auto tab = std::string(pc.dashes(), ' ') + spaces;
+  auto hook_tail = "\u2514" + hline + spaces; // └
+  auto tee_tail = "\u251c" + hline + spaces; // ├
+  auto vline_column = "\u2502" + tab; // │
+  auto blank_column = " " + tab;
+
+  /*
+   * prefix_sizes[d] is the size of the prefix for the children of the last
+   * printed directory with depth d (see Tree<T>::print()).
+   */
+  std::string prefix, line;
+  std::vector<size_t> prefix_sizes(1, 0);
+  size_t nb_dirs = 0;
+  auto enter = [&](const char* name, size_t depth, bool last, \
+      const EntryInfo& info)
+  {
+    if (depth == 0) // the root
+    {
+      line.assign(name);
+      line += '\n';
+      os.write(line.data(), line.size());
+      return;
+    }
+    if (info.type == DT_DIR)
+      nb_dirs++;
+    prefix.resize(prefix_sizes[depth - 1]);
+    line = prefix;
+    line += last ? hook_tail : tee_tail;
+    line += name;
+    line += '\n';
+    os.write(line.data(), line.size());
+    prefix += last ? blank_column : vline_column;
+    prefix_sizes.resize(depth + 1);
+    prefix_sizes[depth] = prefix.size();
+  };
+  walk(enter, [](const char*, size_t) {});
+  os << "\n" << nb_dirs << " directories";
+  if (options_.files)
+    os << ", " << nb_files_ << " files";
+  if (filters())
+    os << ", " << nb_skipped_ << " skipped";
+  os << "\n";
 }
 
 /*
@@ -48,10 +667,21 @@ std::string DirectoryReader::read_directory() const
  * yet simplified our life, and avoided the mix of both C and C++ styles.
  */
 std::vector<Ptr<String>>
-DirectoryReader::subdirectories(const String& current_dir)
+DirectoryReader::subdirectories(const String& current_dir, int* error)
+{
+  std::vector<EntryInfo> infos;
+  return list_entries(current_dir, false, false, infos, error);
+}
+
+std::vector<Ptr<String>>
+DirectoryReader::list_entries(const String& current_dir, bool files, \
+    bool hidden, std::vector<EntryInfo>& infos, int* error)
 {
   /* Try to open the directory. */
+  infos.clear();
   DIR* dirp = opendir(current_dir.c_str());
+  if (error)
+    *error = dirp ? 0 : errno;
   if (!dirp) // In case of failure, we assume that current_dir has no subdirs
     return {};
 
@@ -61,10 +691,18 @@ DirectoryReader::subdirectories(const String& current_dir)
   while ((dp = readdir(dirp)) != nullptr)
   {
     String subdir = dp->d_name; // convert dp->d_name to a std::string
-    if (subdir[0] != '.' and dp->d_type == DT_DIR) // keep only visible dirs
+    if (subdir == "." or subdir == ".." or (subdir[0] == '.' and !hidden))
+      continue;
+    String path = current_dir + "/" + subdir;
+    unsigned char type = dp->d_type;
+    struct stat status;
+    if (type == DT_UNKNOWN and lstat(path.c_str(), &status) == 0)
+      type = entry_type(status.st_mode);
+    if (type == DT_DIR or files) // keep only dirs, or everything
     {
       // and push them to the stack
-      out.push_back(std::make_shared<String>(current_dir + "/" + subdir));
+      out.push_back(std::make_shared<String>(std::move(path)));
+      infos.push_back({type, static_cast<uint64_t>(dp->d_ino)});
     }
   }
   closedir(dirp);
@@ -84,6 +722,9 @@ Table<String> DirectoryReader::table() const
   }
   closedir(dirp);
 
+  if (options_.nb_threads > 1)
+    return parallel_table();
+
   /*
    * Now that we know that 'path_' is a directory, we read recursively
    * its subdirectories using a stack, and store the results in the table.
@@ -109,3 +750,520 @@ Table<String> DirectoryReader::table() const
   }
   return out;
 }
+
+Tree<String, InlineValues> DirectoryReader::tree() const
+{
+  if (!parallel())
+  {
+    TreeBuilder<String, InlineValues> builder;
+    walk([](const char*, size_t, bool, const EntryInfo&) {}, \
+        [&builder](const char* name, size_t nb_subdirs)
+        { builder.push_node(String(name), nb_subdirs); });
+    return builder.build();
+  }
+
+  /*
+   * Generate a tree from the directory table, and keep only the basename
+   * from a directory, e.g. replace a/b/c/d with d, but for the root (the
+   * only path which is not longer than 'path_'), as in walk().
+   * The nodes are independent, so they are mapped in parallel.
+   */
+  const size_t root_size = std::strlen(path_);
+  auto keep_basenames_only = [root_size](const String& s)
+  {
+    size_t idx = s.rfind("/");
+    return (idx == std::string::npos or s.size() == root_size) ? \
+      s : s.substr(idx + 1);
+  };
+  return Tree<String, InlineValues>(table()) \
+    .map_parallel<String>(keep_basenames_only);
+}
+
+Tree<String, InlineValues> DirectoryReader::tree( \
+    const std::function<void(const String&)>& visit) const
+{
+  /* Relative path of the current directory, and the sizes of its prefixes. */
+  String path;
+  std::vector<size_t> path_sizes;
+  auto enter = [&](const char* name, size_t depth, bool last, \
+      const EntryInfo& info)
+  {
+    (void) last;
+    path_sizes.resize(depth);
+    if (depth > 0)
+    {
+      path.resize(path_sizes[depth - 1]);
+      if (depth > 1)
+        path += '/';
+      path += name;
+    }
+    path_sizes.push_back(path.size());
+    if (info.type == DT_DIR and expands(name, depth))
+      visit(path);
+  };
+
+  TreeBuilder<String, InlineValues> builder;
+  walk(enter, [&builder](const char* name, size_t nb_subdirs)
+      { builder.push_node(String(name), nb_subdirs); });
+  return builder.build();
+}
+
+#ifdef __linux__
+/*
+ * Reference: http://man7.org/linux/man-pages/man2/getdents.2.html
+ *
+ * The glibc readdir() also calls getdents64(), but opendir() needs the
+ * whole path of a directory, and allocates a buffer for each of them.
+ */
+template <typename Enter, typename Leave>
+void DirectoryReader::walk(Enter enter, Leave leave, \
+    const EntriesVisitor& entries) const
+{
+  /* Layout of the records filled by getdents64(). */
+  struct LinuxDirent64
+  {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1]; // actually d_reclen - 19 bytes, null-terminated
+  };
+
+  /*
+   * A directory being read: its file descriptor (-1 if it is closed until
+   * the search goes back to it), the offset of its name in the arena, the
+   * range [next, end) of its pending subdirectories in 'subdirs', the
+   * offset of their names in the arena (after its own one, in any order
+   * once sorted), and its device and inode numbers (set when it is closed,
+   * to check that it is the same directory when it is opened again).
+   */
+  struct Frame
+  {
+    int fd;
+    size_t name;
+    size_t first;
+    size_t next;
+    size_t end;
+    size_t names;
+    dev_t dev;
+    ino_t ino;
+  };
+
+  /*
+   * A pending entry (a subdirectory, or a file with files): the offset of
+   * its name in the arena, its index in the cache (ScanCache::npos if it is
+   * not cached), its inode number and its type (as given by getdents64()).
+   */
+  struct Subdir
+  {
+    size_t name;
+    size_t cached;
+    uint64_t ino;
+    unsigned char type;
+  };
+
+  /* Buffer of getdents64(), reused for all directories. */
+  std::vector<char> buffer(1 << 16);
+
+  /*
+   * String arena of the null-terminated names, and their offsets in it.
+   * The names of the subdirectories of a directory are dropped once it is
+   * left, so the arena only holds the subdirectories of the directories on
+   * the current path.
+   */
+  String names;
+  std::vector<Subdir> subdirs;
+
+  /* Names of the other entries of the directory being read, if needed. */
+  String others;
+
+  /* Whether files and hidden entries are listed (files are not with du). */
+  const bool files = options_.files and !entries;
+  const bool hidden = options_.hidden;
+
+  /*
+   * With a cache, the snapshot of the previous search is loaded, and the
+   * one of this search is recorded. A directory whose stamp is unchanged
+   * is not read: its subdirectories are taken from the cache.
+   */
+  const bool caching = !options_.cache_file.empty() and !entries \
+    and !filters() and !files and !hidden;
+  nb_skipped_ = 0;
+  nb_files_ = 0;
+  nb_errors_ = 0;
+  ScanCache cache(path_), snapshot(path_, std::time(nullptr));
+  if (caching)
+    cache.load(options_.cache_file);
+
+  /*
+   * Push the frame of an opened directory, after reading all its visible
+   * subdirectories (i.e., not starting with "."), or all the entries to
+   * list. In case of failure (I/O error), we assume that the directory has
+   * no (more) subdirs.
+   * 'cached' is the index of the directory in the cache, and 'stamp' its
+   * stamp, if it is already known.
+   */
+  std::vector<Frame> frames;
+  std::vector<SortItem> items, scratch;
+  std::vector<Subdir> sorted;
+  auto push_frame = [&](int fd, size_t name, size_t cached, \
+      const ScanCache::Stamp* stamp)
+  {
+    const size_t first = subdirs.size(), first_name = names.size();
+    ScanCache::Stamp st;
+    struct stat status;
+    if (stamp)
+      st = *stamp;
+    else if (caching and fstat(fd, &status) == 0)
+      st = ScanCache::stamp(status);
+
+    if (cached != ScanCache::npos and cache.fresh(cached, st))
+    {
+      for (size_t subdir : cache.subdirs(cached))
+      {
+        subdirs.push_back({names.size(), subdir, 0, DT_DIR});
+        names.append(cache.name(subdir)).push_back('\0');
+      }
+    }
+    else
+    {
+      /*
+       * Keep the entries which may be listed: those of unknown type (on
+       * filesystems which do not tell it) are kept until they are stated.
+       */
+      long nb_bytes;
+      while ((nb_bytes = syscall(SYS_getdents64, fd, buffer.data(), \
+          buffer.size())) > 0)
+      {
+        for (long pos = 0; pos < nb_bytes;)
+        {
+          auto dp = reinterpret_cast<const LinuxDirent64*>(&buffer[pos]);
+          pos += dp->d_reclen;
+          const char* entry = dp->d_name;
+          if (entry[0] == '.' and (!entry[1] \
+              or (entry[1] == '.' and !entry[2]))) // "." or ".."
+            continue;
+          if ((entry[0] == '.' and !hidden) or (!files \
+              and dp->d_type != DT_DIR and dp->d_type != DT_UNKNOWN))
+          {
+            if (entries)
+              others.append(entry).push_back('\0');
+            continue;
+          }
+          subdirs.push_back({names.size(), ScanCache::npos, dp->d_ino, \
+              dp->d_type});
+          names.append(entry).push_back('\0');
+        }
+      }
+
+      /*
+       * State the entries of unknown type, in a row, relatively to the
+       * directory; then drop those which are not listed, and the excluded
+       * ones. The names of the dropped entries stay in the arena until the
+       * directory is left.
+       */
+      size_t end = first;
+      for (size_t k = first; k < subdirs.size(); k++)
+      {
+        Subdir subdir = subdirs[k];
+        const char* entry = &names[subdir.name];
+        if (subdir.type == DT_UNKNOWN \
+            and fstatat(fd, entry, &status, AT_SYMLINK_NOFOLLOW) == 0)
+          subdir.type = entry_type(status.st_mode);
+        if (subdir.type != DT_DIR and !files)
+        {
+          if (entries)
+            others.append(entry).push_back('\0');
+          continue;
+        }
+        if (exclude_.match(entry))
+        {
+          if (subdir.type == DT_DIR)
+            nb_skipped_++;
+          continue;
+        }
+        if (subdir.type == DT_DIR and cached != ScanCache::npos)
+          subdir.cached = cache.find(cached, entry);
+        subdirs[end++] = subdir;
+      }
+      subdirs.resize(end);
+      if (entries)
+      {
+        entries(fd, others);
+        others.clear();
+      }
+    }
+
+    /* Sort the subdirectories, by permuting them (not their names). */
+    if (options_.sort != SortOrder::none and subdirs.size() - first > 1)
+    {
+      items.clear();
+      for (size_t k = first; k < subdirs.size(); k++)
+      {
+        const char* subdir = &names[subdirs[k].name];
+        struct stat status;
+        items.push_back({subdir, 0, k});
+        if (options_.sort != SortOrder::name \
+            and fstatat(fd, subdir, &status, AT_SYMLINK_NOFOLLOW) == 0)
+          items.back().key = sort_key(status, options_.sort);
+      }
+      sort_items(items, options_.sort, scratch);
+      sorted.clear();
+      for (const auto& item : items)
+        sorted.push_back(subdirs[item.index]);
+      std::copy(sorted.begin(), sorted.end(), subdirs.begin() + first);
+    }
+
+    if (caching)
+      snapshot.push(name == String::npos ? path_ : &names[name], st, \
+          subdirs.size() - first);
+    frames.push_back({fd, name, first, first, subdirs.size(), first_name, \
+        0, 0});
+  };
+
+  /*
+   * The file descriptors of the directories on the current path are those
+   * of frames[first_open], ..., frames.back(), so that a deep tree does not
+   * exhaust the file descriptors: the upper ones are closed beyond
+   * max_open_frames, or when opening a directory fails with EMFILE or
+   * ENFILE. A closed directory is opened again from its last subdirectory
+   * (as ".."), or else from its path, when it is back on the top.
+   */
+  size_t first_open = 0;
+  auto path_of = [&](size_t k)
+  {
+    String path = path_;
+    for (size_t i = 1; i <= k; i++)
+      path.append("/").append(&names[frames[i].name]);
+    return path;
+  };
+  auto close_oldest = [&]()
+  {
+    if (first_open + 1 >= frames.size()) // the top one stays open
+      return false;
+    Frame& frame = frames[first_open++];
+    struct stat status;
+    if (fstat(frame.fd, &status) == 0)
+    {
+      frame.dev = status.st_dev;
+      frame.ino = status.st_ino;
+    }
+    close(frame.fd);
+    frame.fd = -1;
+    return true;
+  };
+  auto open_subdir = [&](int dir_fd, const char* name)
+  {
+    int fd;
+    while ((fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) \
+        < 0 and (errno == EMFILE or errno == ENFILE) and close_oldest())
+      continue;
+    return fd;
+  };
+  auto reopen = [&](size_t k, int subdir_fd)
+  {
+    Frame& frame = frames[k];
+    struct stat status;
+    frame.fd = open_subdir(subdir_fd, "..");
+    if (frame.fd >= 0 and (fstat(frame.fd, &status) != 0 \
+          or status.st_dev != frame.dev or status.st_ino != frame.ino))
+    {
+      close(frame.fd); // e.g., the subdirectory has been moved
+      frame.fd = -1;
+    }
+    if (frame.fd < 0)
+      frame.fd = open(path_of(k).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (frame.fd < 0) // its remaining subdirectories are not listed
+    {
+      report(path_of(k), errno);
+      frame.next = frame.end;
+    }
+  };
+
+  /* Try to open 'path_' as a directory, and quit prematurely if it fails. */
+  int fd = open(path_, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) // 'path_' cannot be opened as a directory
+  {
+    std::error_condition econd \
+      = std::generic_category().default_error_condition(errno);
+    throw econd;
+  }
+
+  /* The root name is not in the arena. */
+  struct stat status;
+  enter(path_, 0, true, EntryInfo{DT_DIR, \
+      files and fstat(fd, &status) == 0 ? status.st_ino : 0});
+  push_frame(fd, String::npos, cache.size() > 0 ? 0 : ScanCache::npos, \
+      nullptr);
+  while (!frames.empty())
+  {
+    Frame& top = frames.back();
+    if (top.next < top.end)
+    {
+      const Subdir subdir = subdirs[top.next++];
+      const char* name = &names[subdir.name];
+      enter(name, frames.size(), top.next == top.end, \
+          EntryInfo{subdir.type, subdir.ino});
+      if (subdir.type != DT_DIR) // a file
+      {
+        nb_files_++;
+        leave(name, 0);
+        continue;
+      }
+      if (!entries and !expands(name, frames.size()))
+      {
+        nb_skipped_++;
+        leave(name, 0);
+        continue;
+      }
+
+      /*
+       * A cached directory is first stated relatively to its parent, so
+       * that an unchanged directory without subdirs is not even opened.
+       */
+      ScanCache::Stamp st;
+      const bool stated = subdir.cached != ScanCache::npos \
+        and fstatat(top.fd, name, &status, AT_SYMLINK_NOFOLLOW) == 0;
+      if (stated)
+      {
+        st = ScanCache::stamp(status);
+        if (cache.nb_subdirs(subdir.cached) == 0 \
+            and cache.fresh(subdir.cached, st))
+        {
+          snapshot.push(name, st, 0);
+          leave(name, 0);
+          continue;
+        }
+      }
+
+      fd = open_subdir(top.fd, name);
+      if (fd >= 0)
+      {
+        push_frame(fd, subdir.name, subdir.cached, stated ? &st : nullptr);
+        if (frames.size() - first_open > max_open_frames)
+          close_oldest();
+      }
+      else // we assume that it has no subdirs
+      {
+        if (errno != EACCES and errno != ENOENT)
+          report(path_of(frames.size() - 1) + "/" + name, errno);
+        if (caching)
+          snapshot.push(name, ScanCache::Stamp(), 0);
+        leave(name, 0);
+      }
+      continue;
+    }
+
+    if (first_open + 1 == frames.size() and first_open > 0)
+    {
+      first_open--;
+      reopen(first_open, top.fd); // 'top' is still valid
+    }
+    if (top.fd >= 0)
+      close(top.fd);
+    leave(top.name == String::npos ? path_ : &names[top.name], \
+        top.end - top.first);
+    names.resize(top.names);
+    subdirs.resize(top.first);
+    frames.pop_back();
+  }
+
+  if (caching)
+    snapshot.save(options_.cache_file);
+}
+#else
+template <typename Enter, typename Leave>
+void DirectoryReader::walk(Enter enter, Leave leave, \
+    const EntriesVisitor& entries) const
+{
+  /* A directory being read, and its subdirectories (or entries to list). */
+  struct Frame
+  {
+    Ptr<String> dir;
+    std::vector<Ptr<String>> subdirs;
+    std::vector<EntryInfo> infos;
+    size_t next;
+  };
+
+  (void) entries; // only supported on Linux
+
+  /* Try to open 'path_' as a directory, and quit prematurely if it fails. */
+  DIR* dirp = opendir(path_);
+  if (!dirp) // 'path_' cannot be opened as a directory
+  {
+    std::error_condition econd \
+      = std::generic_category().default_error_condition(errno);
+    throw econd;
+  }
+  closedir(dirp);
+
+  /* Basename of a directory (its path starts with 'path_'). */
+  auto basename = [this](const String& dir)
+  {
+    return dir.size() == std::strlen(path_) ? \
+      path_ : dir.c_str() + dir.rfind('/') + 1;
+  };
+
+  /* Entries of a directory to list, but the excluded ones. */
+  nb_skipped_ = 0;
+  nb_files_ = 0;
+  nb_errors_ = 0;
+  std::vector<Frame> frames;
+  auto push_frame = [this, &basename, &frames](const Ptr<String>& dir)
+  {
+    Frame frame{dir, {}, {}, 0};
+    int error;
+    auto subdirs = list_entries(*dir, options_.files, options_.hidden, \
+        frame.infos, &error);
+    if (error != 0 and error != EACCES and error != ENOENT)
+      report(*dir, error);
+    for (size_t k = 0; k < subdirs.size(); k++)
+    {
+      if (!exclude_.match(basename(*subdirs[k])))
+      {
+        frame.subdirs.push_back(subdirs[k]);
+        frame.infos[frame.subdirs.size() - 1] = frame.infos[k];
+      }
+      else if (frame.infos[k].type == DT_DIR)
+        nb_skipped_++;
+    }
+    frame.infos.resize(frame.subdirs.size());
+    sort_subdirectories(frame.subdirs, &frame.infos);
+    frames.push_back(frame);
+  };
+
+  auto root = std::make_shared<String>(String(path_));
+  struct stat status;
+  enter(path_, 0, true, EntryInfo{DT_DIR, options_.files \
+      and stat(path_, &status) == 0 ? status.st_ino : 0});
+  push_frame(root);
+  while (!frames.empty())
+  {
+    Frame& top = frames.back();
+    if (top.next < top.subdirs.size())
+    {
+      const auto dir = top.subdirs[top.next];
+      const EntryInfo info = top.infos[top.next++];
+      const char* name = basename(*dir);
+      enter(name, frames.size(), top.next == top.subdirs.size(), info);
+      if (info.type != DT_DIR) // a file
+      {
+        nb_files_++;
+        leave(name, 0);
+        continue;
+      }
+      if (!expands(name, frames.size()))
+      {
+        nb_skipped_++;
+        leave(name, 0);
+        continue;
+      }
+      push_frame(dir);
+      continue;
+    }
+
+    leave(basename(*top.dir), top.subdirs.size());
+    frames.pop_back();
+  }
+}
+#endif
@@ -0,0 +1,231 @@
+#include <cstring> // std::memcpy, std::strlen
+#include <dirent.h> // DT_*
+
+#include "../../include/rd/record_writer.hh"
+
+/// Magic string and version of the binary records.
+static const char magic[8] = "rdrecs";
+static const uint32_t version = 1;
+
+/// Header and trailer of the binary records, and head of a record.
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+};
+
+struct Trailer
+{
+  uint64_t nb_records;
+  uint64_t index;
+  char magic[8];
+};
+
+struct RecordHead
+{
+  uint64_t parent;
+  uint32_t depth;
+  uint32_t name_size;
+};
+
+struct RecordType
+{
+  uint64_t ino;
+  uint32_t type;
+  uint32_t padding;
+};
+
+/// Name of an entry type (a DT_* constant) in the JSON records.
+static const char* type_name(unsigned type)
+{
+  switch (type)
+  {
+    case DT_DIR: return "dir";
+    case DT_REG: return "file";
+    case DT_LNK: return "link";
+    case DT_FIFO: return "fifo";
+    case DT_SOCK: return "socket";
+    case DT_CHR: return "char";
+    case DT_BLK: return "block";
+    default: return "unknown";
+  }
+}
+
+/// Size of the output buffer which triggers a flush.
+static const size_t buffer_size = 1 << 16;
+
+RecordWriter::RecordWriter(std::ostream& os, OutputFormat format, \
+    bool usage, bool typed)
+  : os_(os), format_(format), usage_(usage), typed_(typed), nb_records_(0), \
+    offset_(0)
+{
+  buffer_.reserve(2 * buffer_size);
+  if (format_ == OutputFormat::bin)
+  {
+    Header h;
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.flags = (usage_ ? 1 : 0) | (typed_ ? 2 : 0);
+    append_padded(&h, sizeof(h));
+  }
+}
+
+void RecordWriter::append_number(uint64_t n)
+{
+  char digits[20];
+  size_t size = 0;
+  do
+  {
+    digits[size++] = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+  while (size > 0)
+    buffer_ += digits[--size];
+}
+
+void RecordWriter::append_padded(const void* data, size_t size)
+{
+  buffer_.append(static_cast<const char*>(data), size);
+  size_t padded = (size + 7) & ~static_cast<size_t>(7);
+  buffer_.append(padded - size, '\0');
+  offset_ += padded;
+}
+
+void RecordWriter::append_string(const char* s)
+{
+  static const char hex[] = "0123456789abcdef";
+  buffer_ += '"';
+  for (auto p = reinterpret_cast<const unsigned char*>(s); *p;)
+  {
+    const unsigned char c = *p;
+    if (c >= 0x80)
+    {
+      /*
+       * A multibyte UTF-8 sequence: copied if it is valid (neither overlong,
+       * nor a surrogate, nor above U+10FFFF), and replaced by U+FFFD byte
+       * by byte otherwise.
+       */
+      size_t size = (c >= 0xc2 and c <= 0xdf) ? 2 : \
+        (c >= 0xe0 and c <= 0xef) ? 3 : (c >= 0xf0 and c <= 0xf4) ? 4 : 0;
+      bool valid = size > 0;
+      for (size_t k = 1; valid and k < size; k++)
+        valid = (p[k] & 0xc0) == 0x80;
+      if (valid and size == 3)
+        valid = !(c == 0xe0 and p[1] < 0xa0) and !(c == 0xed and p[1] >= 0xa0);
+      if (valid and size == 4)
+        valid = !(c == 0xf0 and p[1] < 0x90) and !(c == 0xf4 and p[1] >= 0x90);
+      if (valid)
+      {
+        buffer_.append(reinterpret_cast<const char*>(p), size);
+        p += size;
+      }
+      else
+      {
+        buffer_ += "\ufffd";
+        p++;
+      }
+      continue;
+    }
+    if (c == '"' or c == '\\')
+    {
+      buffer_ += '\\';
+      buffer_ += c;
+    }
+    else if (c < 0x20)
+    {
+      buffer_ += "\\u00";
+      buffer_ += hex[c >> 4];
+      buffer_ += hex[c & 0xf];
+    }
+    else
+      buffer_ += c;
+    p++;
+  }
+  buffer_ += '"';
+}
+
+void RecordWriter::finish()
+{
+  if (format_ == OutputFormat::bin)
+  {
+    Trailer t;
+    t.nb_records = nb_records_;
+    t.index = offset_;
+    std::memcpy(t.magic, magic, sizeof(magic));
+    for (size_t k = 0; k < index_.size(); k++)
+    {
+      append_padded(&index_[k], sizeof(index_[k]));
+      if (buffer_.size() > buffer_size)
+        flush();
+    }
+    append_padded(&t, sizeof(t));
+  }
+  flush();
+  os_.flush();
+}
+
+void RecordWriter::flush()
+{
+  os_.write(buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+void RecordWriter::write(uint64_t parent, size_t depth, const char* name, \
+    uint64_t bytes, uint64_t inodes, unsigned type, uint64_t ino)
+{
+  if (format_ == OutputFormat::bin)
+  {
+    index_.push_back(offset_);
+    const size_t name_size = std::strlen(name);
+    RecordHead head;
+    head.parent = (depth == 0) ? no_parent : parent;
+    head.depth = depth;
+    head.name_size = name_size;
+    append_padded(&head, sizeof(head));
+    if (usage_)
+    {
+      const uint64_t usage[2] = {bytes, inodes};
+      append_padded(usage, sizeof(usage));
+    }
+    if (typed_)
+    {
+      const RecordType t = {ino, type, 0};
+      append_padded(&t, sizeof(t));
+    }
+    append_padded(name, name_size + 1); // with its null byte
+  }
+  else
+  {
+    buffer_ += "{\"id\":";
+    append_number(nb_records_);
+    buffer_ += ",\"parent\":";
+    if (depth == 0)
+      buffer_ += "null";
+    else
+      append_number(parent);
+    buffer_ += ",\"depth\":";
+    append_number(depth);
+    buffer_ += ",\"name\":";
+    append_string(name);
+    if (usage_)
+    {
+      buffer_ += ",\"bytes\":";
+      append_number(bytes);
+      buffer_ += ",\"inodes\":";
+      append_number(inodes);
+    }
+    if (typed_)
+    {
+      buffer_ += ",\"type\":\"";
+      buffer_ += type_name(type);
+      buffer_ += "\",\"ino\":";
+      append_number(ino);
+    }
+    buffer_ += "}\n";
+  }
+
+  nb_records_++;
+  if (buffer_.size() > buffer_size)
+    flush();
+}
@@ -0,0 +1,203 @@
+#include <algorithm> // std::sort, std::lower_bound
+#include <cerrno>
+#include <cstdio> // std::rename, std::remove
+#include <cstring> // std::memcmp, std::strcmp, std::strlen
+#include <fstream>
+#include <system_error>
+
+#include "../../include/rd/scan_cache.hh"
+
+/// Magic string and version of the file format.
+static const char magic[8] = "rdcache";
+static const uint32_t version = 1;
+
+/// Header of the file, followed by the root path, the records and the names.
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  int64_t scan_time;
+  uint64_t nb_records;
+  uint64_t names_size;
+  uint64_t root_size;
+};
+
+ScanCache::ScanCache(const std::string& root, int64_t scan_time)
+  : root_(root), scan_time_(scan_time), find_dir_(npos)
+{}
+
+size_t ScanCache::find(size_t dir, const char* name) const
+{
+  if (find_dir_ != dir)
+  {
+    find_dir_ = dir;
+    find_subdirs_ = subdirs(dir);
+    std::sort(find_subdirs_.begin(), find_subdirs_.end(), \
+        [this](size_t a, size_t b)
+        { return std::strcmp(this->name(a), this->name(b)) < 0; });
+  }
+  auto it = std::lower_bound(find_subdirs_.begin(), find_subdirs_.end(), \
+      name, [this](size_t a, const char* b)
+      { return std::strcmp(this->name(a), b) < 0; });
+  if (it == find_subdirs_.end() or std::strcmp(this->name(*it), name) != 0)
+    return npos;
+  return *it;
+}
+
+bool ScanCache::fresh(size_t dir, const Stamp& stamp) const
+{
+  const Stamp& s = records_[dir].stamp;
+  return s.sec == stamp.sec and s.nsec == stamp.nsec and s.ino == stamp.ino \
+    and s.dev == stamp.dev and s.sec < scan_time_;
+}
+
+bool ScanCache::load(const std::string& file)
+{
+  records_.clear();
+  names_.clear();
+  subtree_sizes_.clear();
+  find_dir_ = npos;
+
+  /* Read and check the header, and the root path. */
+  std::ifstream in(file, std::ios::binary);
+  Header h;
+  if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) \
+      or std::memcmp(h.magic, magic, sizeof(magic)) != 0 \
+      or h.version != version or h.record_size != sizeof(Record) \
+      or h.root_size != root_.size())
+    return false;
+  std::string root(root_.size(), '\0');
+  if (!in.read(&root[0], root.size()) or root != root_)
+    return false;
+
+  /* Read the records and the names, and check the offsets of the names. */
+  try
+  {
+    records_.resize(h.nb_records);
+    names_.resize(h.names_size);
+  }
+  catch (const std::exception&) // the sizes are garbage
+  {
+    records_.clear();
+    names_.clear();
+    return false;
+  }
+  bool valid = in.read(reinterpret_cast<char*>(records_.data()), \
+      records_.size() * sizeof(Record)) \
+    and in.read(&names_[0], names_.size()) \
+    and (names_.empty() or names_.back() == '\0');
+  for (size_t i = 0; valid and i < records_.size(); i++)
+    valid = records_[i].name < names_.size();
+
+  /*
+   * Compute the sizes of the subtrees in reverse pre-order: the children of
+   * a directory follow it, each one after the subtree of the previous one.
+   * This also checks that the numbers of subdirectories are consistent.
+   */
+  subtree_sizes_.assign(records_.size(), 1);
+  for (size_t i = records_.size(); valid and i-- > 0;)
+  {
+    size_t child = i + 1;
+    for (uint64_t k = 0; valid and k < records_[i].nb_subdirs; k++)
+    {
+      valid = child < records_.size();
+      if (valid)
+      {
+        subtree_sizes_[i] += subtree_sizes_[child];
+        child += subtree_sizes_[child];
+      }
+    }
+  }
+  valid = valid and (records_.empty() or subtree_sizes_[0] == records_.size());
+
+  if (!valid)
+  {
+    records_.clear();
+    names_.clear();
+    subtree_sizes_.clear();
+    return false;
+  }
+  scan_time_ = h.scan_time;
+  return true;
+}
+
+const char* ScanCache::name(size_t dir) const
+{
+  return &names_[records_[dir].name];
+}
+
+size_t ScanCache::nb_subdirs(size_t dir) const
+{
+  return records_[dir].nb_subdirs;
+}
+
+void ScanCache::push(const char* name, const Stamp& stamp, size_t nb_subdirs)
+{
+  records_.push_back({stamp, names_.size(), nb_subdirs});
+  names_.append(name).push_back('\0');
+}
+
+void ScanCache::save(const std::string& file) const
+{
+  Header h;
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.record_size = sizeof(Record);
+  h.scan_time = scan_time_;
+  h.nb_records = records_.size();
+  h.names_size = names_.size();
+  h.root_size = root_.size();
+
+  const std::string tmp = file + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(root_.data(), root_.size());
+    out.write(reinterpret_cast<const char*>(records_.data()), \
+        records_.size() * sizeof(Record));
+    out.write(names_.data(), names_.size());
+    out.close();
+    if (!out)
+    {
+      int error = errno ? errno : EIO;
+      std::remove(tmp.c_str());
+      throw std::system_error(error, std::generic_category(), \
+          "cannot write cache " + file);
+    }
+  }
+  if (std::rename(tmp.c_str(), file.c_str()) != 0)
+  {
+    int error = errno;
+    std::remove(tmp.c_str());
+    throw std::system_error(error, std::generic_category(), \
+        "cannot write cache " + file);
+  }
+}
+
+size_t ScanCache::size() const
+{
+  return records_.size();
+}
+
+ScanCache::Stamp ScanCache::stamp(const struct stat& st)
+{
+  Stamp s;
+  s.sec = st.st_mtim.tv_sec;
+  s.nsec = st.st_mtim.tv_nsec;
+  s.ino = st.st_ino;
+  s.dev = st.st_dev;
+  return s;
+}
+
+std::vector<size_t> ScanCache::subdirs(size_t dir) const
+{
+  std::vector<size_t> out;
+  size_t child = dir + 1;
+  for (uint64_t k = 0; k < records_[dir].nb_subdirs; k++)
+  {
+    out.push_back(child);
+    child += subtree_sizes_[child];
+  }
+  return out;
+}
@@ -0,0 +1,361 @@
+#ifdef __linux__
+
+#include <algorithm> // std::count
+#include <cerrno>
+#include <chrono>
+#include <cstring> // std::memchr
+#include <functional> // std::function
+#include <iostream> // std::cerr
+#include <set>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h> // close, read
+
+#include "../../include/rd/watcher.hh"
+#include "../../include/tree/subtree_view.hh"
+
+/// Events watched in every directory.
+static const uint32_t watched_events = IN_CREATE | IN_DELETE | IN_MOVED_FROM \
+  | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+/**
+ * Delay (in milliseconds) during which the next events are waited for,
+ * before a batch is printed, and maximal duration of a batch.
+ */
+static const int batch_delay = 10;
+static const int max_batch_duration = 100;
+
+DirectoryWatcher::DirectoryWatcher(const String& path, \
+    const ReaderOptions& options)
+  : path_(path), options_(options), prune_(options.prune), \
+    exclude_(options.exclude), fd_(-1), exhausted_(false)
+{}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+bool DirectoryWatcher::apply(const inotify_event& event, \
+    std::vector<String>& changed)
+{
+  /* The queue overflowed: events were lost, so search everything again. */
+  if (event.mask & IN_Q_OVERFLOW)
+  {
+    removed_.clear();
+    unwatch("");
+    tree_ = search("");
+    changed.push_back("");
+    return true;
+  }
+
+  auto it = paths_.find(event.wd);
+  if (it == paths_.end()) // an event of a directory which is unwatched
+    return true;
+  const String path = it->second;
+
+  /* The watch was removed, e.g. as the directory was deleted. */
+  if (event.mask & IN_IGNORED)
+  {
+    auto wit = watches_.find(path);
+    if (wit != watches_.end() and wit->second == event.wd)
+      watches_.erase(wit);
+    paths_.erase(it);
+    return !path.empty();
+  }
+
+  /*
+   * The directory itself was deleted or moved: this is handled by the event
+   * of its parent, except for the top directory.
+   */
+  if (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+    return !path.empty();
+
+  /* Keep only visible directories which are not excluded, as in the search. */
+  if (!(event.mask & IN_ISDIR) or event.len == 0 or event.name[0] == '.' \
+      or exclude_.match(event.name))
+    return true;
+  if (event.mask & (IN_CREATE | IN_MOVED_TO)) // the ids must be up to date
+    flush();
+  size_t id = find(path);
+  if (id == String::npos)
+    return true;
+  const String name = event.name;
+  const String subdir = path.empty() ? name : path + "/" + name;
+  size_t subdir_id = find(id, name);
+
+  if (event.mask & (IN_CREATE | IN_MOVED_TO))
+  {
+    if (subdir_id != String::npos) // already found by a search
+      return true;
+
+    /*
+     * Search the new directory (which may already be gone), and insert its
+     * tree, with its basename as root, as the last child of its parent.
+     */
+    Tree<String, InlineValues> tree;
+    try
+    {
+      tree = search(subdir);
+    }
+    catch (const std::error_condition&)
+    {
+      return true;
+    }
+    size_t arity = SubtreeView<String, InlineValues>(tree_, id).root_arity();
+    tree_.insert_subtree(id, arity, \
+        Tree<String, InlineValues>(name, tree.root_children()));
+  }
+  else if (event.mask & (IN_DELETE | IN_MOVED_FROM))
+  {
+    if (subdir_id == String::npos)
+      return true;
+    unwatch(subdir);
+    removed_.push_back(subdir_id);
+  }
+  else
+    return true;
+
+  changed.push_back(path);
+  return true;
+}
+
+size_t DirectoryWatcher::find(const String& path) const
+{
+  if (tree_.size() == 0)
+    return String::npos;
+  size_t id = 0;
+  for (size_t begin = 0; id != String::npos and begin < path.size();)
+  {
+    size_t end = path.find('/', begin);
+    if (end == String::npos)
+      end = path.size();
+    id = find(id, path.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return id;
+}
+
+size_t DirectoryWatcher::find(size_t id, const String& name) const
+{
+  SubtreeView<String, InlineValues> view(tree_, id);
+  for (size_t k = 0; k < view.root_arity(); k++)
+  {
+    size_t child = view.child(k).begin();
+    if (tree_.value(child) == name)
+      return child;
+  }
+  return String::npos;
+}
+
+void DirectoryWatcher::flush()
+{
+  if (!removed_.empty())
+  {
+    tree_.remove_subtrees(removed_);
+    removed_.clear();
+  }
+}
+
+String DirectoryWatcher::full_path(const String& path) const
+{
+  return path.empty() ? path_ : path_ + "/" + path;
+}
+
+void DirectoryWatcher::print(std::ostream& os, const String& path) const
+{
+  size_t id = find(path);
+  if (id == String::npos)
+    return;
+
+  const String label = full_path(path);
+  std::function<String(String)> print_leaf = [](String x) { return x; };
+  std::function<String(String)> \
+    print_root = [&label](String x) { (void) x; return label; };
+  TreePrintCompanion<String> pc(print_leaf, print_leaf, print_root);
+  SubtreeView<String, InlineValues>(tree_, id).print(os, pc);
+}
+
+void DirectoryWatcher::run(std::ostream& os, int input)
+{
+  using Clock = std::chrono::steady_clock;
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0)
+    throw std::system_error(errno, std::generic_category(), \
+        "cannot watch " + path_);
+
+  tree_ = search("");
+  print(os, "");
+  os << "\n" << tree_.size() - 1 << " directories" << std::endl;
+
+  /* Buffer of the events, aligned as required by inotify. */
+  std::vector<inotify_event> buffer(65536 / sizeof(inotify_event));
+  char* const events = reinterpret_cast<char*>(buffer.data());
+  const size_t events_size = buffer.size() * sizeof(inotify_event);
+
+  pollfd fds[2] = {{fd_, POLLIN, 0}, {input, POLLIN, 0}};
+  nfds_t nfds = (input >= 0) ? 2 : 1;
+  std::vector<String> changed;
+  while (true)
+  {
+    if (poll(fds, nfds, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::system_error(errno, std::generic_category(), \
+          "cannot watch " + path_);
+    }
+
+    /* Print the whole tree on demand. */
+    if (nfds == 2 and fds[1].revents)
+    {
+      char line[256];
+      ssize_t len = read(input, line, sizeof(line));
+      if (len <= 0) // no more input
+        nfds = 1;
+      else if (std::memchr(line, '\n', len))
+      {
+        print(os, "");
+        os << "\n" << tree_.size() - 1 << " directories" << std::endl;
+      }
+    }
+    if (!(fds[0].revents & POLLIN))
+      continue;
+
+    /*
+     * Apply a batch of events: the pending ones, and those following them
+     * within a short delay (e.g., when a whole subtree is being created).
+     */
+    const auto start = Clock::now();
+    Clock::duration applying(0);
+    size_t nb_events = 0;
+    bool alive = true;
+    changed.clear();
+    do
+    {
+      ssize_t len;
+      while ((len = read(fd_, events, events_size)) > 0)
+      {
+        const auto begin = Clock::now();
+        for (ssize_t pos = 0; pos < len;)
+        {
+          auto event = reinterpret_cast<const inotify_event*>(events + pos);
+          alive = apply(*event, changed) and alive;
+          nb_events++;
+          pos += sizeof(inotify_event) + event->len;
+        }
+        applying += Clock::now() - begin;
+      }
+    } while (alive and Clock::now() - start < \
+        milliseconds(max_batch_duration) and poll(fds, 1, batch_delay) > 0);
+    const auto begin = Clock::now();
+    flush();
+    applying += Clock::now() - begin;
+
+    /*
+     * Print the changed directories, but those lying below another one,
+     * as they are printed with it.
+     */
+    std::set<String> printed(changed.begin(), changed.end());
+    for (const auto& path : printed)
+    {
+      bool below = !path.empty() and printed.count("") > 0;
+      for (size_t end = path.find('/'); !below and end != String::npos; \
+          end = path.find('/', end + 1))
+        below = printed.count(path.substr(0, end)) > 0;
+      if (!below)
+        print(os, path);
+    }
+    os << "\n" << tree_.size() - 1 << " directories (events: " \
+      << nb_events << ", applied in " \
+      << duration_cast<microseconds>(applying).count() << " us, printed " \
+      << duration_cast<milliseconds>(Clock::now() - start).count() \
+      << " ms after the first one)" << std::endl;
+
+    if (!alive)
+    {
+      os << path_ << " [directory removed]" << std::endl;
+      return;
+    }
+  }
+}
+
+Tree<String, InlineValues> DirectoryWatcher::search(const String& path)
+{
+  /*
+   * Every directory is watched before it is read, so that no subdirectory
+   * created meanwhile is missed. The cache is only used for the initial
+   * search. Only directories are watched, so files are not listed.
+   */
+  ReaderOptions options = options_;
+  options.files = options.hidden = false;
+  if (!path.empty())
+  {
+    options.cache_file.clear();
+
+    /* The depth limit is relative to the directory. */
+    const size_t depth = std::count(path.begin(), path.end(), '/') + 1;
+    const String name = path.substr(path.rfind('/') + 1);
+    if ((options.max_depth > 0 and depth >= options.max_depth) \
+        or prune_.match(name.c_str()))
+      return Tree<String, InlineValues>(name);
+    if (options.max_depth > 0)
+      options.max_depth -= depth;
+  }
+  const String full = full_path(path);
+  return DirectoryReader(full, options).tree([this, &path](const String& p)
+      { watch(path.empty() ? p : p.empty() ? path : path + "/" + p); });
+}
+
+void DirectoryWatcher::unwatch(const String& path)
+{
+  /* The watches of the subtree: the directory, and the range below it. */
+  std::vector<std::map<String, int>::iterator> range;
+  if (path.empty())
+    for (auto it = watches_.begin(); it != watches_.end(); it++)
+      range.push_back(it);
+  else
+  {
+    auto it = watches_.find(path);
+    if (it != watches_.end())
+      range.push_back(it);
+    for (it = watches_.lower_bound(path + "/"); \
+        it != watches_.lower_bound(path + "0"); it++) // '0' follows '/'
+      range.push_back(it);
+  }
+
+  for (auto it : range)
+  {
+    inotify_rm_watch(fd_, it->second);
+    paths_.erase(it->second);
+    watches_.erase(it);
+  }
+}
+
+void DirectoryWatcher::watch(const String& path)
+{
+  /* Do not follow symbolic links, but for the top directory. */
+  uint32_t mask = watched_events | (path.empty() ? 0 : IN_DONT_FOLLOW);
+  int wd = inotify_add_watch(fd_, full_path(path).c_str(), mask);
+  if (wd >= 0)
+  {
+    paths_[wd] = path;
+    watches_[path] = wd;
+  }
+  else if (errno == ENOSPC and !exhausted_)
+  {
+    exhausted_ = true;
+    std::cerr << "rd: the limit of inotify watches is reached, some" \
+      " directories are not watched (see fs.inotify.max_user_watches)" \
+      << std::endl;
+  }
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include <cerrno>
+#include <cstdio> // std::remove, std::rename
+#include <cstring> // std::memcmp, std::memcpy
+#include <fstream>
+#include <system_error>
+
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close
+
+#include "../../include/tree/mapped_tree.hh"
+#include "../../include/tree/tree_error.hh"
+
+/// Magic string, version and byte order mark of the snapshots.
+static const char magic[8] = "treemap";
+static const uint32_t version = 1;
+static const uint64_t byte_order = 0x0102030405060708;
+
+MappedFile::MappedFile(const std::string& file)
+  : data_(nullptr), size_(0)
+{
+  int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat status;
+  if (fd < 0 or fstat(fd, &status) != 0)
+  {
+    int error = errno;
+    if (fd >= 0)
+      close(fd);
+    throw std::system_error(error, std::generic_category(), \
+        "cannot read " + file);
+  }
+
+  /* An empty file cannot be mapped, and has no data. */
+  size_ = status.st_size;
+  if (size_ > 0)
+  {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), \
+          "cannot map " + file);
+    }
+    data_ = static_cast<const char*>(data);
+  }
+  close(fd); // the mapping stays valid
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+  : data_(other.data_), size_(other.size_)
+{
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+  if (this != &other)
+  {
+    if (data_)
+      munmap(const_cast<char*>(data_), size_);
+    data_ = other.data_;
+    size_ = other.size_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+const char* MappedFile::data() const
+{
+  return data_;
+}
+
+size_t MappedFile::size() const
+{
+  return size_;
+}
+
+/**
+ * Tell if the arrays of a snapshot of n > 0 nodes are those of a tree (see
+ * Tree<T>): the children of every node are the roots of consecutive subtrees
+ * which follow it, and split its subtree, and the parents, depths, heights
+ * and numbers of leaves match them. The ids are bounded before being used.
+ */
+static bool valid_arrays(const uint64_t* parents, uint64_t n, \
+    uint64_t nb_leaves)
+{
+  const uint64_t* child_offsets = parents + n;
+  const uint64_t* children = child_offsets + n + 1;
+  const uint64_t* depths = children + n - 1;
+  const uint64_t* heights = depths + n;
+  const uint64_t* subtree_sizes = heights + n;
+  if (child_offsets[0] != 0 or child_offsets[n] != n - 1 or parents[0] != 0 \
+      or depths[0] != 0 or subtree_sizes[0] != n)
+    return false;
+
+  uint64_t leaves = 0;
+  for (uint64_t id = 0; id < n; id++)
+  {
+    const uint64_t begin = child_offsets[id], end = child_offsets[id + 1];
+    const uint64_t size = subtree_sizes[id];
+    if (end < begin or end > n - 1 or size == 0 or size > n - id)
+      return false;
+    if (begin == end)
+      leaves++;
+
+    /* The next child starts right after the subtree of the previous one. */
+    uint64_t next = id + 1, height = 0;
+    for (uint64_t k = begin; k < end; k++)
+    {
+      const uint64_t c = children[k];
+      if (c != next or c >= id + size or parents[c] != id \
+          or depths[c] != depths[id] + 1 or subtree_sizes[c] == 0 \
+          or subtree_sizes[c] > id + size - c)
+        return false;
+      next = c + subtree_sizes[c];
+      if (heights[c] + 1 > height)
+        height = heights[c] + 1;
+    }
+    if (next != id + size or heights[id] != height)
+      return false;
+  }
+  return leaves == nb_leaves;
+}
+
+/**
+ * Tell if the offsets of the string table of a snapshot of n nodes (with
+ * a values section of the given size) follow each other in the table, and
+ * if every value ends with its null character.
+ */
+static bool valid_strings(const char* values, uint64_t n, \
+    uint64_t values_size)
+{
+  const uint64_t* offsets = reinterpret_cast<const uint64_t*>(values);
+  const char* table = values + (n + 1) * sizeof(uint64_t);
+  const uint64_t table_size = values_size - (n + 1) * sizeof(uint64_t);
+  if (offsets[0] != 0 or offsets[n] != table_size)
+    return false;
+  for (uint64_t id = 0; id < n; id++)
+    if (offsets[id + 1] <= offsets[id] or offsets[id + 1] > table_size \
+        or table[offsets[id + 1] - 1] != '\0')
+      return false;
+  return true;
+}
+
+uint64_t check_snapshot(const MappedFile& file, uint32_t flags, \
+    uint64_t value_size)
+{
+  const std::string error = "[ERROR] Calling MappedTree<T>::MappedTree()" \
+    " failed: ";
+  if (file.size() < sizeof(SnapshotHeader))
+    throw TreeException::InvalidSnapshot(error + "Not a tree snapshot\n");
+  SnapshotHeader h;
+  std::memcpy(&h, file.data(), sizeof(h));
+  if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 \
+      or h.version != version or h.byte_order != byte_order)
+    throw TreeException::InvalidSnapshot(error + "Not a tree snapshot" \
+        " (or of another version, or byte order)\n");
+  if (h.flags != flags or h.value_size != value_size)
+    throw TreeException::InvalidSnapshot(error + "Other type of values\n");
+
+  /*
+   * Check the sizes of the sections against the size of the file (the
+   * numbers of nodes and bytes are first bounded, so nothing overflows).
+   */
+  const uint64_t n = h.nb_nodes, available = file.size() - sizeof(h);
+  const uint64_t arrays_size = (n > 0 ? 6 * n : 1) * sizeof(uint64_t);
+  const uint64_t padded_size = (h.values_size + 7) & ~static_cast<uint64_t>(7);
+  if (n > available / (6 * sizeof(uint64_t)) + 1 or h.nb_leaves > n \
+      or arrays_size > available or h.values_size > available \
+      or (flags & 1 and h.values_size < (n + 1) * sizeof(uint64_t)) \
+      or (!(flags & 1) and h.values_size != n * value_size) \
+      or arrays_size + padded_size != available)
+    throw TreeException::InvalidSnapshot(error + "Truncated snapshot\n");
+
+  /* Check the arrays and the string table, which are read unchecked. */
+  const auto arrays = \
+    reinterpret_cast<const uint64_t*>(file.data() + sizeof(h));
+  const char* values = file.data() + sizeof(h) + arrays_size;
+  if ((n > 0 and !valid_arrays(arrays, n, h.nb_leaves)) \
+      or (n == 0 and arrays[0] != 0) \
+      or (flags & 1 and !valid_strings(values, n, h.values_size)))
+    throw TreeException::InvalidSnapshot(error + "Corrupted snapshot\n");
+  return arrays_size;
+}
+
+void pad_section(std::ostream& os, uint64_t size)
+{
+  static const char zeros[8] = {0};
+  os.write(zeros, (8 - size % 8) % 8);
+}
+
+void save_snapshot(const std::string& file, const SnapshotHeader& header, \
+    const std::function<void(std::ostream&)>& write)
+{
+  const std::string tmp = file + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write(out);
+    out.close();
+    if (!out)
+    {
+      int error = errno ? errno : EIO;
+      std::remove(tmp.c_str());
+      throw std::system_error(error, std::generic_category(), \
+          "cannot write snapshot " + file);
+    }
+  }
+  if (std::rename(tmp.c_str(), file.c_str()) != 0)
+  {
+    int error = errno;
+    std::remove(tmp.c_str());
+    throw std::system_error(error, std::generic_category(), \
+        "cannot write snapshot " + file);
+  }
+}
+
+SnapshotHeader snapshot_header(uint32_t flags, uint64_t nb_nodes, \
+    uint64_t nb_leaves, uint64_t value_size, uint64_t values_size)
+{
+  SnapshotHeader h;
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.flags = flags;
+  h.byte_order = byte_order;
+  h.nb_nodes = nb_nodes;
+  h.nb_leaves = nb_leaves;
+  h.value_size = value_size;
+  h.values_size = values_size;
+  return h;
+}
@@ -0,0 +1,179 @@
+#include "../../include/tree/thread_pool.hh"
+
+/* Worker thread identification: pool and queue owned by this thread. */
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local size_t current_queue = 0;
+
+/* Task run by this thread (if any): its pool and its group. */
+static thread_local const ThreadPool* running_pool = nullptr;
+static thread_local ThreadPool::TaskGroup* running_group = nullptr;
+
+ThreadPool::TaskGroup::TaskGroup()
+  : unfinished_(0)
+{}
+
+ThreadPool::ThreadPool(size_t nb_threads)
+  : nb_threads_(nb_threads), queued_(0), nb_waiting_(0), next_queue_(0), \
+    stop_(false)
+{
+  if (nb_threads_ == 0)
+    nb_threads_ = std::thread::hardware_concurrency();
+  if (nb_threads_ == 0)
+    nb_threads_ = 1;
+  for (size_t i = 0; i < nb_threads_; i++)
+    queues_.emplace_back(new Queue);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+size_t ThreadPool::nb_threads() const
+{
+  return nb_threads_;
+}
+
+bool ThreadPool::run_one(size_t self)
+{
+  Task task;
+
+  /* Pop the last task of our own queue, or steal the first task of another. */
+  for (size_t k = 0; k < nb_threads_ and !task.run; k++)
+  {
+    size_t i = (self + k) % nb_threads_;
+    std::lock_guard<std::mutex> lock(queues_[i]->mutex);
+    auto& tasks = queues_[i]->tasks;
+    if (tasks.empty())
+      continue;
+    if (i == self)
+    {
+      task = std::move(tasks.back());
+      tasks.pop_back();
+    }
+    else
+    {
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+  }
+  if (!task.run)
+    return false;
+  queued_--;
+
+  /* The tasks it submits belong to its group (this may be a nested task). */
+  const ThreadPool* pool = running_pool;
+  TaskGroup* group = running_group;
+  running_pool = this;
+  running_group = task.group;
+  try
+  {
+    task.run();
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!task.group->error_)
+      task.group->error_ = std::current_exception();
+  }
+  running_pool = pool;
+  running_group = group;
+
+  /* The group may be destroyed as soon as it is done. */
+  if (--task.group->unfinished_ == 0)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nb_waiting_ > 0)
+      done_.notify_all();
+  }
+  return true;
+}
+
+ThreadPool& ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::start()
+{
+  for (size_t i = 0; i < nb_threads_; i++)
+    threads_.emplace_back(&ThreadPool::work, this, i);
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+  submit(std::move(task), \
+      (running_pool == this) ? *running_group : group_);
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskGroup& group)
+{
+  std::call_once(started_, &ThreadPool::start, this);
+
+  size_t i = (current_pool == this) \
+    ? current_queue : next_queue_++ % nb_threads_;
+  group.unfinished_++;
+  {
+    std::lock_guard<std::mutex> lock(queues_[i]->mutex);
+    queues_[i]->tasks.push_back({std::move(task), &group});
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_++;
+    if (nb_waiting_ > 0) // the waiting threads run tasks too
+      done_.notify_all();
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+  wait(group_);
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+  /* Help the workers while there are tasks to run, then sleep. */
+  const size_t self = (current_pool == this) ? current_queue : nb_threads_;
+  while (group.unfinished_ > 0)
+  {
+    if (run_one(self))
+      continue;
+    std::unique_lock<std::mutex> lock(mutex_);
+    nb_waiting_++;
+    done_.wait(lock, [this, &group]()
+        { return group.unfinished_ == 0 or queued_ > 0; });
+    nb_waiting_--;
+  }
+
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(error, group.error_);
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void ThreadPool::work(size_t self)
+{
+  current_pool = this;
+  current_queue = self;
+
+  while (true)
+  {
+    if (run_one(self))
+      continue;
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait(lock, [this]() { return stop_ or queued_ > 0; });
+    if (stop_ and queued_ == 0)
+      return;
+  }
+}
@@ -0,0 +1,74 @@
+#include "../../include/tree/tree_arena.hh"
+
+#include <cstdint> // std::uintptr_t
+#include <new> // operator new, operator delete
+
+MonotonicArena::MonotonicArena(size_t block_size)
+  : next_block_size_(block_size > 0 ? block_size : 1), current_(nullptr), \
+    end_(nullptr), size_(0)
+{}
+
+MonotonicArena::~MonotonicArena()
+{
+  for (auto block : blocks_)
+    ::operator delete(block);
+}
+
+void* MonotonicArena::allocate(size_t n, size_t alignment)
+{
+  /* Align the bump pointer; the padding is lost. */
+  auto address = reinterpret_cast<std::uintptr_t>(current_);
+  size_t padding = (alignment - address % alignment) % alignment;
+
+  if (current_ == nullptr or n + padding > static_cast<size_t>(end_ - current_))
+  {
+    /*
+     * Allocate a new block, large enough for the request. Blocks returned
+     * by operator new are suitably aligned for any fundamental type.
+     */
+    size_t block_size = next_block_size_;
+    while (block_size < n + alignment)
+      block_size *= 2;
+    char* block = static_cast<char*>(::operator new(block_size));
+    blocks_.push_back(block);
+    block_sizes_.push_back(block_size);
+    next_block_size_ = 2 * block_size;
+
+    current_ = block;
+    end_ = block + block_size;
+    padding = 0;
+  }
+
+  void* p = current_ + padding;
+  current_ += padding + n;
+  size_ += n;
+  return p;
+}
+
+size_t MonotonicArena::nb_blocks() const
+{
+  return blocks_.size();
+}
+
+void MonotonicArena::release()
+{
+  if (blocks_.empty())
+    return;
+
+  /* Keep the last block (which is the largest one), free the others. */
+  for (size_t i = 0; i + 1 < blocks_.size(); i++)
+    ::operator delete(blocks_[i]);
+  char* last = blocks_.back();
+  size_t last_size = block_sizes_.back();
+  blocks_.assign(1, last);
+  block_sizes_.assign(1, last_size);
+
+  current_ = last;
+  end_ = last + last_size;
+  size_ = 0;
+}
+
+size_t MonotonicArena::size() const
+{
+  return size_;
+}
@@ -10,7 +10,15 @@ namespace TreeException
     : BaseException(message)
   {}
 
+  NoSuchNode::NoSuchNode(const std::string& message)
+    : BaseException(message)
+  {}
+
   InvalidTable::InvalidTable(const std::string& message)
     : BaseException(message)
   {}
+
+  InvalidSnapshot::InvalidSnapshot(const std::string& message)
+    : BaseException(message)
+  {}
 }